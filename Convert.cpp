@@ -0,0 +1,266 @@
+#include "dbms.h"
+
+using namespace std;
+
+// table_struct_v1 --- title of the table in the first format,
+// where every record is the full field_struct of every field
+struct table_struct_v1
+{
+    char table_name [MAX_TABLE_NAME_LEN];
+    unsigned long num_of_fields;
+    unsigned long num_of_records;
+    unsigned long title_length;
+};
+
+// table_struct_v2 --- title of the table in the second format,
+// where records hold only data of the fields
+struct table_struct_v2
+{
+    char magic [TABLE_MAGIC_LEN];
+    unsigned long version;
+    char table_name [MAX_TABLE_NAME_LEN];
+    unsigned long num_of_fields;
+    unsigned long num_of_records;
+    unsigned long title_length;
+    unsigned long row_length;
+};
+
+// table_struct_v3 --- title of the table in the third format,
+// where records can be stored by columns
+struct table_struct_v3
+{
+    char magic [TABLE_MAGIC_LEN];
+    unsigned long version;
+    char table_name [MAX_TABLE_NAME_LEN];
+    unsigned long num_of_fields;
+    unsigned long num_of_records;
+    unsigned long title_length;
+    unsigned long row_length;
+    unsigned long storage;
+    unsigned long capacity;
+};
+
+// unpacking the record of the second or the third format,
+// which has no flag of deleting
+void unpack_old_line (const char * buf, Table & table)
+{
+    for (unsigned long i = 0; i < table.t_struct.num_of_fields; i++)
+    {
+        table.unpack_field (i, buf);
+        buf += table.fields[i].field_len;
+    }
+}
+
+// reading the descriptions of fields to the new table
+void read_fields (FILE * f, unsigned long num, Table & table)
+{
+    for (unsigned long i = 0; i < num; i++)
+    {
+        struct field_struct f_struct;
+        if (fread (&(f_struct), sizeof (f_struct), 1, f) == 0)
+        {
+            throw TableException (TableException :: ESE_FILEREAD);
+        }
+        if (f_struct.type == TEXT)
+        {
+            table.add_text (f_struct.name, f_struct.field_len);
+        }
+        else
+        {
+            table.add_long (f_struct.name);
+        }
+    }
+}
+
+// copying the table of the first format
+void convert_v1 (FILE * f, string t_name)
+{
+    struct table_struct_v1 old_struct;
+    if (fread (&(old_struct), sizeof (old_struct), 1, f) == 0)
+    {
+        throw TableException (TableException :: ESE_FILEREAD);
+    }
+    Table table;
+    read_fields (f, old_struct.num_of_fields, table);
+    table.create_table (t_name);
+    for (unsigned long j = 0; j < old_struct.num_of_records; j++)
+    {
+        for (unsigned long i = 0; i < table.t_struct.num_of_fields; i++)
+        {
+            if (fread (&(table.fields[i]), sizeof (struct field_struct), 1,
+                       f) == 0)
+            {
+                throw TableException (TableException :: ESE_FILEREAD);
+            }
+        }
+        table.add_line ();
+    }
+}
+
+// copying the table of the second format
+void convert_v2 (FILE * f, string t_name)
+{
+    struct table_struct_v2 old_struct;
+    if (fread (&(old_struct), sizeof (old_struct), 1, f) == 0)
+    {
+        throw TableException (TableException :: ESE_FILEREAD);
+    }
+    Table table;
+    read_fields (f, old_struct.num_of_fields, table);
+    table.create_table (t_name);
+    vector <char> line (old_struct.row_length);
+    for (unsigned long j = 0; j < old_struct.num_of_records; j++)
+    {
+        if (fread (&(line[0]), old_struct.row_length, 1, f) == 0)
+        {
+            throw TableException (TableException :: ESE_FILEREAD);
+        }
+        unpack_old_line (&(line[0]), table);
+        table.add_line ();
+    }
+}
+
+// copying the table of the third format
+void convert_v3 (FILE * f, string t_name)
+{
+    struct table_struct_v3 old_struct;
+    if (fread (&(old_struct), sizeof (old_struct), 1, f) == 0)
+    {
+        throw TableException (TableException :: ESE_FILEREAD);
+    }
+    Table table;
+    read_fields (f, old_struct.num_of_fields, table);
+    table.t_struct.storage = old_struct.storage;
+    table.create_table (t_name);
+    vector <char> line (old_struct.row_length);
+    for (unsigned long j = 0; j < old_struct.num_of_records; j++)
+    {
+        if (old_struct.storage == ROW_STORAGE)
+        {
+            if (fread (&(line[0]), old_struct.row_length, 1, f) == 0)
+            {
+                throw TableException (TableException :: ESE_FILEREAD);
+            }
+            unpack_old_line (&(line[0]), table);
+            table.add_line ();
+            continue;
+        }
+        // the values of the record are taken from every segment
+        unsigned long offset = 0;
+        for (unsigned long i = 0; i < table.t_struct.num_of_fields; i++)
+        {
+            unsigned long len = table.fields[i].field_len;
+            if (fseek (f, old_struct.title_length + 
+                       old_struct.capacity * offset + j * len, 
+                       SEEK_SET) != 0)
+            {
+                throw TableException (TableException :: ESE_FILESEEK);
+            }
+            if (fread (&(line[offset]), len, 1, f) == 0)
+            {
+                throw TableException (TableException :: ESE_FILEREAD);
+            }
+            offset += len;
+        }
+        unpack_old_line (&(line[0]), table);
+        table.add_line ();
+    }
+}
+
+// converting one table file, the result replaces the old file
+void convert_table (string t_name)
+{
+    string file_name = t_name + ".txt";
+    FILE * f = fopen (file_name.c_str(), "rb");
+    if (f == NULL)
+    {
+        throw TableException (TableException :: ESE_FILEOPEN);
+    }
+    struct table_struct_v2 t_struct;
+    if (fread (&(t_struct), sizeof (t_struct), 1, f) == 0)
+    {
+        throw TableException (TableException :: ESE_FILEREAD);
+    }
+    unsigned long version = 1;
+    // files without the tag are written in the first format
+    if (memcmp (t_struct.magic, TABLE_MAGIC, TABLE_MAGIC_LEN) == 0)
+    {
+        version = t_struct.version;
+    }
+    fclose (f);
+    if (version == TABLE_VERSION)
+    {
+        cout << t_name << ": the format is current" << endl;
+        return;
+    }
+    if (version > TABLE_VERSION)
+    {
+        throw TableException (TableException :: ESE_VERSION);
+    }
+    // the old file is read while the new one is written with its name
+    string old_name = t_name + ".old";
+    if (rename (file_name.c_str(), old_name.c_str()) != 0)
+    {
+        throw TableException (TableException :: ESE_FILERENAME);
+    }
+    f = fopen (old_name.c_str(), "rb");
+    if (f == NULL)
+    {
+        throw TableException (TableException :: ESE_FILEOPEN);
+    }
+    try
+    {
+        if (version == 1)
+        {
+            convert_v1 (f, t_name);
+        }
+        else if (version == 2)
+        {
+            convert_v2 (f, t_name);
+        }
+        else
+        {
+            convert_v3 (f, t_name);
+        }
+    }
+    catch (TableException &)
+    {
+        // the old file gets its name back
+        fclose (f);
+        table_files :: close (t_name);
+        rename (old_name.c_str(), file_name.c_str());
+        throw;
+    }
+    fclose (f);
+    table_files :: close (t_name);
+    if (remove (old_name.c_str()) != 0)
+    {
+        throw TableException (TableException :: ESE_FILEREMOVE);
+    }
+    cout << t_name << ": converted" << endl;
+}
+
+int main (int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        cout << "Usage: Convert <table> ..." << endl;
+        return 1;
+    }
+    int res = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        try
+        {
+            convert_table (argv[i]);
+        }
+        catch (TableException & e)
+        {
+            // error --- output the message
+            cout << argv[i] << ": ";
+            e.report();
+            res = 1;
+        }
+    }
+    return res;
+}
@@ -48,6 +48,11 @@ class MyServerSocket : public ServerSocket
                 }
                 cout.rdbuf(coutbuf);
             }
+            // the table files stay opened during the whole session
+            {
+                lock_guard <mutex> lock (wal :: db_lock);
+                table_files :: close_all ();
+            }
             pConn->put_string_ ("END");
             delete pConn;
         }
@@ -55,6 +60,23 @@ class MyServerSocket : public ServerSocket
 
 int main (int argc, char* argv[])
 {
+    // the size of the buffer pool in pages can be given
+    if (argc > 1)
+    {
+        buffer_pool :: set_capacity (atol (argv[1]));
+    }
+    // the changes lost by the last stop of the server are restored
+    try
+    {
+        wal :: start ();
+        // the catalog is read once before clients come
+        catalog :: load ();
+    }
+    catch (TableException & e)
+    {
+        e.report();
+        return 1;
+    }
     try 
     {
         // create socket
@@ -68,5 +90,6 @@ int main (int argc, char* argv[])
         // error --- input to the screen
         e.report();
     }
+    wal :: stop ();
     return 0;
 }
@@ -5,11 +5,117 @@
 #define MAX_TABLE_NAME_LEN 15
 #define MAX_TEXT_LEN 20
 
+// tag and version of the table file format
+#define TABLE_MAGIC "MODELSQL"
+#define TABLE_MAGIC_LEN 8
+#define TABLE_VERSION 4
+
+// the first byte of the record marks deleted records
+#define ROW_FLAG_LEN 1
+#define ROW_LIVE 0
+#define ROW_DELETED 1
+// deleted records are removed from the file when there are
+// at least VACUUM_MIN_RECORDS of them and VACUUM_PERCENT of all records
+#define VACUUM_MIN_RECORDS 64
+#define VACUUM_PERCENT 25
+
+// records the column segments get room for at once
+#define COLUMN_START_CAPACITY 64
+// size of the buffer for moving data inside the file
+#define MOVE_BUF_SIZE 65536
+// the mapping of the table file grows by such parts
+#define MAP_STEP (1 << 20)
+// pages of table files in the buffer pool
+#define POOL_PAGE_SIZE 4096
+#define POOL_PAGES 256
+// size of the buffer for full scans of the table
+#define SCAN_BUF_SIZE 65536
+// the scanner gives records of the block by batches of such size
+// for checking the where-clause by columns, a multiple of 64
+#define BATCH_LINES 1024
+// records appended to the end of the file are written by such parts
+#define APPEND_BUF_SIZE 65536
+// write-ahead log of all changes of table files
+#define WAL_FILE "wal.log"
+// the tables are checkpointed after such time or such size of the log
+#define WAL_CHECKPOINT_SEC 30
+#define WAL_CHECKPOINT_SIZE (16 << 20)
+// the writer of the log starts without waiting for a commit
+#define WAL_BUF_SIZE (1 << 20)
+// secondary indexes of the table are listed in the file <table>.ind,
+// every index is kept in the file <table>.<index>.idx
+#define INDEX_MAGIC "MODELIDX"
+#define INDEX_VERSION 1
+#define MAX_INDEX_NAME_LEN 15
+#define MAX_FILE_NAME_LEN 47
+// keys in one page of the B+tree
+#define BTREE_ITEMS ((POOL_PAGE_SIZE - sizeof (struct btree_head)) / \
+                     sizeof (struct btree_item))
+// pages of the B+tree built at once are filled to such part,
+// so next insertions do not split them at once
+#define BTREE_FILL_PERCENT 75
+// keys in one page of the hash index
+#define HASH_ITEMS ((POOL_PAGE_SIZE - sizeof (struct hash_head)) / \
+                    sizeof (struct hash_item))
+// buckets of the new hash index, their number is doubled when keys
+// take more than such part of the first pages of buckets
+#define HASH_START_BUCKETS 8
+#define HASH_LOAD_PERCENT 75
+// records of the table are divided into zones of ZONE_LINES records,
+// the file <table>.zone keeps the least and the greatest value
+// of every LONG field in every zone
+#define ZONE_LINES 1024
+// bits of the Bloom filter of one zone by default and at most,
+// the number of hash functions is chosen for ZONE_LINES texts in the filter
+#define BLOOM_BITS 8192
+#define BLOOM_MAX_BITS 65536
+#define BLOOM_MAX_HASHES 8
+// records keep codes of such size for TEXT fields with a dictionary,
+// the values of the dictionaries are kept in the file <table>.dict
+#define DICT_CODE_LEN sizeof (unsigned short)
+#define DICT_MAX_VALUES 65536
+// compressed tables: positions of the LZ matches are kept in the hash table
+// of such bits, matches are searched so far back
+#define LZ_HASH_BITS 12
+#define LZ_WINDOW 65535
+#define LZ_MIN_MATCH 4
+// statistics of the file <table>.stat: least hashes of values kept to
+// estimate the number of distinct values, values of the sorted LONG
+// field kept for every zone, buckets of the histogram of the LONG field
+// and most common values of the TEXT field
+#define STAT_HASHES 128
+#define STAT_SAMPLES 16
+#define STAT_BUCKETS 8
+#define STAT_COMMON 8
+// the file with names and fields of all tables
+#define CATALOG_FILE "tables.cat"
+// compiled LIKE patterns and programs of where-clauses kept for next
+// statements, the least recently used ones are removed
+#define CACHE_PATTERNS 64
+#define CACHE_PROGRAMS 64
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
 #include <iostream>
 #include <fstream>
+#include <iterator>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <thread>
+#include <unistd.h>
 #include <vector>
 
 using namespace std;
@@ -21,7 +127,9 @@ enum field_type
     LONG
 };
 
-// field_struct --- structure for one field
+// field_struct --- structure for one field,
+// in the title l_num of the TEXT field is the width of its code in the 
+// dictionary, 0 - the record keeps the text itself
 struct field_struct
 {
     char name [MAX_FIELD_NAME_LEN];
@@ -31,13 +139,259 @@ struct field_struct
     unsigned long field_len;
 };
 
+// storage_type --- placement of the records in the file
+enum storage_type
+{
+    ROW_STORAGE,    // records follow each other
+    COLUMN_STORAGE, // every field has its own segment of values
+    COMPRESSED_STORAGE // values of every field in every zone are compressed
+};
+
 // table_struct --- main info about table
+// the title of the file is table_struct and field_struct of every field,
+// records hold the flag byte and data: sizeof (long) bytes for LONG and
+// field_len bytes for TEXT
+// with COLUMN_STORAGE the flags are placed in the first segment of
+// capacity bytes, values of the i-th field are placed in the segment
+// of capacity * field_len bytes after the segments of previous fields
+// with COMPRESSED_STORAGE the title is followed by column_block of every
+// field of every zone and by the compressed values, such table has no
+// deleted records, its capacity keeps the storage_type the table had
+// before and gets back before any change
 struct table_struct
 {
+    char magic [TABLE_MAGIC_LEN]; // tag of the file format
+    unsigned long version;
     char table_name [MAX_TABLE_NAME_LEN];
     unsigned long num_of_fields;
     unsigned long num_of_records;
     unsigned long title_length; // for easy pointer moving
+    unsigned long row_length; // size of one record in the file
+    unsigned long storage; // storage_type of the records
+    unsigned long capacity; // room for records in column segments
+    unsigned long num_of_deleted; // records marked as deleted
+};
+
+// index_type --- kinds of secondary indexes
+enum index_type
+{
+    BTREE_INDEX, // B+tree of LONG values
+    HASH_INDEX,  // hash table of TEXT values
+    TRIGRAM_INDEX, // B+tree of trigrams of TEXT values for LIKE
+    BLOOM_INDEX // Bloom filters of TEXT values of every zone
+};
+
+// index_struct --- description of one index in the list of the table
+struct index_struct
+{
+    char name [MAX_INDEX_NAME_LEN + 1];
+    char field_name [MAX_FIELD_NAME_LEN + 1];
+    unsigned long type; // index_type
+};
+
+// btree_item --- key of the B+tree: the value and the number of the record,
+// in inner pages child is the page with keys not less than this one
+struct btree_item
+{
+    long key;
+    unsigned long row;
+    unsigned long child;
+};
+
+// btree_head --- beginning of every page of the B+tree
+struct btree_head
+{
+    unsigned long leaf; // 1 - the page of keys, 0 - inner page
+    unsigned long count; // keys in the page
+    unsigned long next; // the next leaf, 0 - the last one
+    unsigned long first; // inner page: the child with keys less than all
+};
+
+// btree_page --- page of the B+tree, count items follow the head
+struct btree_page
+{
+    struct btree_head head;
+    struct btree_item items [BTREE_ITEMS];
+};
+
+// btree_meta --- the first page of the index file
+struct btree_meta
+{
+    char magic [TABLE_MAGIC_LEN];
+    unsigned long version;
+    unsigned long root;
+    unsigned long pages; // pages in the file with this one
+};
+
+// hash_item --- key of the hash index: the text and the number of the record
+struct hash_item
+{
+    unsigned long row;
+    char key [MAX_TEXT_LEN]; // the rest of the text is filled with zeros
+};
+
+// hash_head --- beginning of every page of the hash index,
+// pages of one bucket are linked in the chain
+struct hash_head
+{
+    unsigned long count; // keys in the page
+    unsigned long next; // the next page of the bucket, 0 - the last one
+};
+
+// hash_page --- page of the hash index, count items follow the head
+struct hash_page
+{
+    struct hash_head head;
+    struct hash_item items [HASH_ITEMS];
+};
+
+// hash_meta --- the first page of the hash index file,
+// the pages from 1 to buckets begin the chains of buckets
+struct hash_meta
+{
+    char magic [TABLE_MAGIC_LEN];
+    unsigned long version;
+    unsigned long buckets;
+    unsigned long pages; // pages in the file with this one
+    unsigned long count; // keys in the index
+};
+
+// bloom_meta --- the beginning of the file of Bloom filters,
+// the filters of zones follow it one after another
+struct bloom_meta
+{
+    char magic [TABLE_MAGIC_LEN];
+    unsigned long version;
+    unsigned long bits; // bits in the filter of one zone
+    unsigned long hashes; // bits set for one text
+};
+
+// column_block --- place of compressed values of one field in one zone
+struct column_block
+{
+    unsigned long pos;
+    unsigned long len;
+};
+
+// dict_entry --- one value of the dictionary of the field,
+// values of the field get codes in the order of the entries
+struct dict_entry
+{
+    unsigned long field; // number of the field
+    char text [MAX_TEXT_LEN]; // the rest of the text is filled with zeros
+};
+
+// dictionary --- values of one field with a dictionary by codes and back
+struct dictionary
+{
+    vector <string> values;
+    map <string, unsigned long> codes;
+};
+
+// zone_range --- values of one LONG field in one zone,
+// min greater than max - the zone has no values
+struct zone_range
+{
+    long min;
+    long max;
+};
+
+// catalog_entry --- description of one table in the catalog,
+// it is followed by field_struct of every field
+struct catalog_entry
+{
+    char table_name [MAX_TABLE_NAME_LEN + 1];
+    char file_name [MAX_TABLE_NAME_LEN + 5]; // the name with ".txt"
+    unsigned long storage; // storage_type given by CREATE TABLE
+    unsigned long num_of_fields;
+};
+
+// catalog_table --- the table in the catalog kept in memory
+struct catalog_table
+{
+    struct catalog_entry entry;
+    vector <field_struct> fields;
+};
+
+// stat_value --- the text of the field and the number of records with it
+struct stat_value
+{
+    char text [MAX_TEXT_LEN];
+    unsigned long count;
+};
+
+// zone_stats --- statistics of one field in one zone, ANALYZE makes them
+// again only for zones changed after it, texts are filled with zeros
+struct zone_stats
+{
+    unsigned long rows; // not deleted records
+    unsigned long non_null; // values which are not empty texts
+    long min;
+    long max;
+    char min_text [MAX_TEXT_LEN];
+    char max_text [MAX_TEXT_LEN];
+    unsigned long num_hashes;
+    unsigned long hashes [STAT_HASHES]; // the least hashes of the values
+    unsigned long num_samples;
+    long samples [STAT_SAMPLES]; // values at equal steps of the sorted zone
+    unsigned long num_common;
+    stat_value common [STAT_COMMON]; // the most common texts of the zone
+};
+
+// column_stats --- statistics of one field of the table,
+// merged from the statistics of all zones
+struct column_stats
+{
+    unsigned long rows;
+    unsigned long distinct; // the estimate by the least hashes
+    unsigned long non_null;
+    long min;
+    long max;
+    char min_text [MAX_TEXT_LEN];
+    char max_text [MAX_TEXT_LEN];
+    unsigned long num_bounds; // the histogram of LONG field (equi-depth)
+    long bounds [STAT_BUCKETS + 1];
+    unsigned long num_common;
+    stat_value common [STAT_COMMON];
+};
+
+// stat_head --- the beginning of the file <table>.stat, it is followed
+// by column_stats of every field and then for every zone by the flag
+// of changes after ANALYZE and zone_stats of every field
+struct stat_head
+{
+    unsigned long num_of_records; // not deleted records at ANALYZE
+    unsigned long num_of_fields;
+};
+
+// io_counters --- numbers of system calls made with table files
+struct io_counters
+{
+    unsigned long opens;
+    unsigned long closes;
+    unsigned long reads;
+    unsigned long writes;
+    unsigned long maps;
+    unsigned long hits;       // pages found in the buffer pool
+    unsigned long misses;     // pages loaded to the buffer pool
+    unsigned long evictions;  // pages replaced in the buffer pool
+    unsigned long write_backs; // dirty pages written to the files
+    unsigned long scan_blocks; // blocks read by scanners
+    unsigned long zone_skips; // zones scanners did not read
+    unsigned long log_syncs; // fsync of the log, one for a group of commits
+    // compiled LIKE patterns and programs of where-clauses found in the
+    // cache, compiled again and removed from the cache
+    unsigned long cache_hits;
+    unsigned long cache_misses;
+    unsigned long cache_evictions;
+};
+
+// access_type --- expected order of reading records
+enum access_type
+{
+    NORMAL_ACCESS,
+    SEQUENTIAL_ACCESS, // full scans of the table
+    RANDOM_ACCESS      // reading separate records
 };
 
 // TableException --- exception class
@@ -58,7 +412,12 @@ public:
         ESE_LINEFIND,
         ESE_LINENUM,
         ESE_FIELDLEN,
-        ESE_FILENAME
+        ESE_FILENAME,
+        ESE_VERSION,
+        ESE_INDEXNAME,
+        ESE_FIELDTYPE,
+        ESE_INDEXSIZE,
+        ESE_DICTFULL
     };
     TableException (table_exception_code);
     void report (); // output the message
@@ -74,22 +433,501 @@ public:
     TableClass ();
     void add_text (const char *, const int); // add new field with text
     void add_long (const char *); // add new field with number
+    // add new field with text kept in the dictionary
+    void add_dict_text (const char *, const int);
+    void pack_line (char *); // data of fields to the file record
+    void unpack_line (const char *); // file record to data of fields
+    void unpack_field (unsigned long, const char *);
     ~ TableClass () {}
 };
 
+// TableFile --- table file which stays opened between statements
+struct TableFile
+{
+    string name; // name of the file
+    int fd;
+    unsigned long id; // number of the opened file for the buffer pool
+    struct table_struct t_struct; // cached title of the table
+    vector <field_struct> fields;
+    vector <unsigned long> offsets; // field positions in the record
+    vector <unsigned long> widths; // bytes of the fields in the record
+    vector <char> line; // buffer for one record
+    off_t file_len; // with the pages which are not written yet
+    off_t disk_len; // size of the file on the disk
+    char * map; // the file mapped for reading, or NULL
+    size_t map_len;
+    vector <char> tail; // appended data which is not written yet
+    off_t tail_pos; // place of the tail in the file
+    bool title_dirty; // t_struct is changed and not written yet
+    struct table_struct logged_title; // the title known by the log
+    bool unsynced; // written after the last fsync
+    vector <index_struct> indexes; // secondary indexes of the table
+    vector <dictionary> dicts; // by numbers of fields, empty for others
+    // values of the zone of the compressed table read last,
+    // empty for fields which are not read yet
+    unsigned long cached_zone;
+    vector <vector <char> > zone_columns;
+    bool analyzed; // the file <table>.stat exists
+    // free-space map: deleted records new records can take, it is
+    // found by the flags of records at the first insert after opening
+    set <unsigned long> free_lines;
+    bool free_known;
+};
+
+// page_frame --- place of one page in the buffer pool
+struct page_frame
+{
+    TableFile * file; // NULL if the frame is free
+    unsigned long page;
+    bool dirty;
+};
+
+// buffer_pool --- pages of all table files shared by all tables,
+// the least recently used page is replaced,
+// changed pages are written to the files when they are replaced
+// and at the end of every statement
+namespace buffer_pool
+{
+    unsigned long capacity = POOL_PAGES;
+    vector <char> data;
+    vector <page_frame> frames;
+    list <unsigned long> lru; // used frames, the last is the oldest
+    vector <list <unsigned long> :: iterator> lru_pos;
+    vector <unsigned long> free_frames;
+    // frame of the page with the number of the file and of the page
+    map <pair <unsigned long, unsigned long>, unsigned long> pages;
+    void set_capacity (unsigned long);
+    // the page is valid until the next call of get_page
+    char * get_page (TableFile &, unsigned long, bool);
+    void write_back (unsigned long);
+    void flush (TableFile &); // write changed pages of the file
+    void flush_all ();
+    void drop (TableFile &); // forget pages of the file
+    // copy data written past the pool to the pages which are in the pool
+    void copy_in (TableFile &, const char *, size_t, off_t);
+}
+
+// table_files --- cache of opened table files and files of indexes
+// every file is opened once, the data is read and written 
+// through the buffer pool
+// durability: records appended to the row table are collected in the tail
+// of the file and the changed title waits in t_struct, both are written
+// by flush, the title after the data, so after a crash the file holds
+// the records the title counts; flush is called when the tail is full,
+// before the file is changed in other ways, at the end of every statement
+// except INSERT and when the file is closed
+namespace table_files
+{
+    map <string, TableFile> files; // by names of the files
+    unsigned long last_id = 0;
+    // with the log the removed files stay on the disk till the commit
+    // of the statement is synced
+    set <string> dropped;
+    TableFile & open (string);
+    TableFile & create (string, struct table_struct &, 
+                        vector <field_struct> &);
+    // file without the title of the table, the new one is empty
+    TableFile & open_data (string, bool);
+    void close (string);
+    void close_file (string);
+    void close_all ();
+    void remove_file (string); // the closed file is removed
+    // the dropped files are removed when the commit is synced
+    void remove_dropped (unsigned long);
+    bool exists (string);
+    // the list of indexes of the table
+    void load_indexes (TableFile &);
+    void save_indexes (TableFile &);
+    // files of indexes, the zone map, statistics and dictionaries
+    // are removed
+    void drop_side_files (string);
+    string index_file_name (TableFile &, index_struct &);
+    // dictionaries of the TEXT fields of the table
+    void load_dicts (TableFile &);
+    void append_dict (TableFile &, unsigned long, string); // the new value
+    void flush (TableFile &); // write the tail, pages and title of the file
+    void flush_all ();
+    void sync_all (); // fsync of the written files
+    void log_title (TableFile &); // the changed title to the log
+    void log_titles ();
+    void read_at (TableFile &, void *, size_t, off_t);
+    // the change is written to the log and to the pool
+    void write_at (TableFile &, const void *, size_t, off_t);
+    void store_at (TableFile &, const void *, size_t, off_t); // without log
+    void resize (TableFile &, off_t);
+    void append (TableFile &, const void *, size_t); // to the end
+    void write_tail (TableFile &);
+    // pointer to the data in the pool or copy of it in the buffer
+    const char * view (TableFile &, off_t, size_t, char *);
+    // reading and writing without the buffer pool
+    void read_disk (TableFile &, void *, size_t, off_t);
+    // the same with the data of the tail
+    void read_direct (TableFile &, void *, size_t, off_t);
+    void write_disk (TableFile &, const void *, size_t, off_t);
+    void move_data (TableFile &, off_t, off_t, size_t);
+    void set_offsets (TableFile &);
+    void map_file (TableFile &);
+    void advise (TableFile &, access_type);
+}
+
+// wal_record_type --- kinds of records in the log
+enum wal_record_type
+{
+    WAL_WRITE,  // new and old bytes of the place in the file
+    WAL_APPEND, // new bytes at the end of the file
+    WAL_SIZE,   // new size of the file and bytes cut from it
+    WAL_CREATE, // new file with the title
+    WAL_DROP,   // the file is removed
+    WAL_COMMIT, // the end of the statement
+    WAL_ABORT   // the changes of the failed statement are undone
+};
+
+// wal_record --- head of the record in the log, the data follows it
+struct wal_record
+{
+    unsigned long type;
+    unsigned long txn; // number of the statement
+    char file_name [MAX_FILE_NAME_LEN + 1];
+    unsigned long pos; // place of the data, the old size for WAL_SIZE
+    unsigned long len; // length of new bytes, the new size for WAL_SIZE
+    unsigned long data_len; // bytes after the head
+    unsigned long check; // sum of the head and of the data
+};
+
+// wal --- write-ahead log, changes of table files are written to the log
+// before the files, the writer thread syncs the log once for all commits
+// collected while the previous fsync worked (group commit), the 
+// checkpointer thread writes the tables and empties the log,
+// recovery at the start repeats committed changes and rolls back others,
+// the failed statement is rolled back at once and gets no commit
+namespace wal
+{
+    bool enabled = false;
+    int fd = -1;
+    unsigned long txn = 0; // the current statement
+    unsigned long txn_lsn = 0; // the place where the statement begins
+    vector <char> buf; // records which are not written yet
+    unsigned long next_lsn = 0; // bytes given to the log
+    unsigned long durable_lsn = 0; // bytes written and synced
+    unsigned long log_len = 0; // size of the log file
+    bool stopping = false;
+    bool failed = false; // the log can't be written
+    bool txn_changed = false; // the statement has records in the log
+    mutex db_lock; // statements and checkpoints work one by one
+    mutex log_lock; // for the fields above
+    condition_variable write_cond; // the writer has work
+    condition_variable durable_cond; // a group of commits is synced
+    condition_variable checkpoint_cond; // the log is big
+    thread writer;
+    thread checkpointer;
+    void start (); // recovery and start of the threads
+    void stop ();
+    void begin (); // start of the statement
+    unsigned long commit (); // the place the statement has to wait for
+    void rollback (); // the failed statement
+    void wait (unsigned long);
+    void force (); // all records are written and synced
+    void checkpoint ();
+    void recover ();
+    // the change of the record is undone in the file
+    void undo (map <string, int> &, wal_record &, const char *);
+    unsigned long sum (const void *, size_t, unsigned long);
+    void fill (wal_record &, wal_record_type, string, unsigned long, 
+               unsigned long);
+    void add (wal_record &, const void *, size_t, const void *, size_t);
+    void log_write (TableFile &, off_t, size_t, const void *, const void *);
+    void log_append (TableFile &, off_t, size_t, const void *);
+    void log_size (TableFile &, off_t, off_t, const void *);
+    void log_create (string, const void *, size_t);
+    void log_drop (string);
+    void write_loop ();
+    void checkpoint_loop ();
+}
+
+// btree --- B+tree in the index file, every key is the value and 
+// the number of the record, so equal values are kept in order of records,
+// pages are read and written through the buffer pool,
+// keys are removed without merging of pages
+namespace btree
+{
+    void read_meta (TableFile &, btree_meta &);
+    void write_meta (TableFile &, btree_meta &);
+    void read_page (TableFile &, unsigned long, btree_page &);
+    // the head and the items from the given one are written
+    void write_page (TableFile &, unsigned long, btree_page &, unsigned long);
+    // the place of the first item greater than the key
+    unsigned long upper (btree_page &, long, unsigned long);
+    unsigned long child (btree_page &, long, unsigned long);
+    bool item_less (const btree_item &, const btree_item &);
+    void build (TableFile &, vector <btree_item> &); // from sorted keys
+    void insert (TableFile &, long, unsigned long);
+    void erase (TableFile &, long, unsigned long);
+    // numbers of records with values from the first to the second
+    void find (TableFile &, long, long, vector <unsigned long> &);
+}
+
+// hash_index --- hash table of texts in the index file, the key is found
+// by reading the chain of pages of its bucket, the table grows twice
+// when its chains become long
+namespace hash_index
+{
+    void read_meta (TableFile &, hash_meta &);
+    void write_meta (TableFile &, hash_meta &);
+    void read_page (TableFile &, unsigned long, hash_page &);
+    // the head and the items from the given one are written
+    void write_page (TableFile &, unsigned long, hash_page &, unsigned long);
+    void make_item (hash_item &, string, unsigned long);
+    bool same_key (hash_item &, string);
+    unsigned long bucket (string, unsigned long);
+    unsigned long buckets_for (unsigned long); // buckets for such keys
+    void build (TableFile &, vector <hash_item> &, unsigned long);
+    void grow (TableFile &); // twice more buckets
+    void insert (TableFile &, string, unsigned long);
+    void erase (TableFile &, string, unsigned long);
+    // numbers of records with the text
+    void find (TableFile &, string, vector <unsigned long> &);
+}
+
+// trigram_index --- every three following bytes of the text are the key 
+// of the B+tree with the number of the record, so records of the trigram
+// are found in ascending order, texts shorter than three bytes have no keys
+namespace trigram_index
+{
+    void codes (string, vector <long> &); // different trigrams of the text
+    void insert (TableFile &, string, unsigned long);
+    void erase (TableFile &, string, unsigned long);
+    // numbers of records with all trigrams of all fragments of text
+    void find (TableFile &, const vector <string> &, 
+               vector <unsigned long> &);
+}
+
+// bloom --- Bloom filter of texts of every zone of records in the index 
+// file, the filter can only tell that the zone has no such text, 
+// so texts are never removed from it
+namespace bloom
+{
+    void make_meta (bloom_meta &, unsigned long); // for such bits
+    void read_meta (TableFile &, bloom_meta &);
+    void write_meta (TableFile &, bloom_meta &);
+    // numbers of bits of the text in the filter
+    void positions (string, bloom_meta &, vector <unsigned long> &);
+    off_t filter_pos (bloom_meta &, unsigned long); // filter of the zone
+    void build (TableFile &, bloom_meta &, vector <hash_item> &);
+    void insert (TableFile &, string, unsigned long);
+    // zones whose filters have none of the texts
+    void find (TableFile &, const vector <string> &, vector <bool> &);
+}
+
+// codec --- compression of values of one field in one zone:
+// LONG values are kept as differences from the least value or as
+// differences between following values (frame of reference and delta),
+// all of them by the same number of bits; other values are compressed
+// by LZ77: literal bytes and copies of earlier bytes
+namespace codec
+{
+    unsigned long bits_for (unsigned long); // bits of the number
+    void put_bits (vector <char> &, unsigned long &, unsigned long, 
+                   unsigned long);
+    unsigned long get_bits (const char *, unsigned long &, unsigned long);
+    void pack_longs (const char *, unsigned long, vector <char> &);
+    void unpack_longs (const char *, size_t, unsigned long, char *);
+    void put_length (vector <char> &, unsigned long); // the rest after 15
+    unsigned long get_length (const char *, size_t, size_t &);
+    void lz_compress (const char *, size_t, vector <char> &);
+    void lz_decompress (const char *, size_t, char *, size_t);
+}
+
+// catalog --- names and fields of all tables, the file is read once,
+// then tables learn their fields from the memory; CREATE and DROP write
+// the whole file through the log with other changes of the statement
+namespace catalog
+{
+    map <string, catalog_table> tables; // by names of tables
+    bool loaded = false;
+    // the first loading without the file looks for tables in the directory
+    void load ();
+    void save ();
+    void add (struct table_struct &, vector <field_struct> &);
+    void remove (string);
+    catalog_table * find (string); // NULL if there is no such table
+    // the title and fields of the table file with current format
+    bool read_title (string, struct table_struct &, vector <field_struct> &);
+}
+
+// stats --- statistics of fields: zone_stats are made from the values
+// of one zone and are merged into column_stats of the table
+namespace stats
+{
+    unsigned long hash (const void *, size_t);
+    // STAT_HASHES least of the hashes to the zone
+    void least_hashes (const set <unsigned long> &, zone_stats &);
+    void zone_longs (vector <long> &, zone_stats &);
+    void zone_texts (const vector <string> &, zone_stats &);
+    // all zones of the field with such number
+    void merge (const vector <zone_stats> &, unsigned long, unsigned long,
+                bool, column_stats &);
+    string text (const char *); // the text filled with zeros
+}
+
+// io_stats --- counters of the current statement and of the whole work
+namespace io_stats
+{
+    struct io_counters cur = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    struct io_counters total = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    void start_statement (); // the next statement counts from zero
+    void print ();
+}
+
 // Table --- class for work with tables
 class Table : public TableClass
 {
+public:
+    // Scanner --- reading records one after another,
+    // the records are read by big blocks to the buffer of the scanner
+    class Scanner
+    {
+    private:
+        Table & table;
+        TableFile & tf;
+        vector <char> buf;
+        unsigned long block_lines; // records in the full block
+        unsigned long first; // the first record in the buffer (from 0)
+        unsigned long count; // records in the buffer
+        unsigned long cur; // the current record (from 1), 0 - before all
+        unsigned long batch_start; // the first record of the batch (from 1)
+        vector <bool> skipped; // zones next does not read
+        void load (unsigned long);
+        bool deleted (); // the current record is marked as deleted
+    public:
+        Scanner (Table &);
+        // go to the next not deleted record, false after the last
+        bool next ();
+        // next passes by records of the zones marked with true
+        void skip_zones (const vector <bool> &);
+        void go (const unsigned long); // go to the record with number
+        unsigned long line_num ();
+        // the value of the field of the current record,
+        // the pointer is valid until the next move of the scanner
+        const char * value (unsigned long);
+        long get_long (unsigned long);
+        string get_text (unsigned long);
+        unsigned long code (unsigned long); // of the field with dictionary
+        void read (); // the current record to the fields of the table
+        // the records after the current one till the end of the block,
+        // but no more than BATCH_LINES, are taken as one batch, the last
+        // of them becomes current, the number of records is given,
+        // 0 after the last one; deleted records are in the batch too
+        unsigned long next_batch ();
+        unsigned long batch_first (); // the number of the first record
+        // values of the LONG field of all records of the batch
+        void batch_longs (unsigned long, long *);
+        // bits of not deleted records of the batch, 64 records in the word
+        void batch_live (unsigned long long *);
+        ~ Scanner ();
+    };
+private:
+    vector <bool> used_fields; // fields read by read_line, empty - all
+    // place of the value in the file
+    off_t field_pos (TableFile &, unsigned long, unsigned long);
+    off_t flag_pos (TableFile &, unsigned long);
+    void read_record (TableFile &, unsigned long);
+    void write_record (TableFile &, unsigned long);
+    void grow_columns (TableFile &); // more room in column segments
+    void shrink_columns (TableFile &); // no room for more than records
+    void find_free (TableFile &); // the free-space map by the flags
+    // statistics: the place of the zone in the file <table>.stat,
+    // the zone of the changed record gets the flag of changes
+    off_t stat_zone_pos (TableFile &, unsigned long);
+    void stat_touch (TableFile &, unsigned long);
+    bool encoded (TableFile &, unsigned long); // the field has a dictionary
+    // the fields to the record, new texts of fields with dictionaries
+    // get codes if learn is true, otherwise they are not found
+    void pack_record (TableFile &, char *, bool);
+    void unpack_record (TableFile &, const char *);
+    void unpack_value (TableFile &, unsigned long, const char *);
+    unsigned long dict_code (TableFile &, unsigned long, bool);
+    // the text of the field by its bytes in the record
+    string text_value (TableFile &, unsigned long, const char *);
+    // compressed values of the field in the zone, the last argument 
+    // is true for reading past the buffer pool
+    void load_block (TableFile &, unsigned long, unsigned long, char *, 
+                     bool);
+    // the value of the compressed table, the zone is kept in the file
+    const char * zone_value (TableFile &, unsigned long, unsigned long);
+    void decompress (TableFile &); // the compressed table to columns
+    TableFile & index_file (TableFile &, index_struct &);
+    void build_index (TableFile &, index_struct &);
+    // the record with number (from 1) to the index,
+    // the value is taken from the field
+    void index_add (TableFile &, index_struct &, unsigned long);
+    // the record with number from the index, the value is read 
+    // from the file
+    void index_remove (TableFile &, index_struct &, unsigned long);
+    // the field and the record in the file have different values
+    bool index_changed (index_struct &, unsigned long);
+    vector <unsigned long> zone_fields (TableFile &); // LONG fields
+    // the zone map is built at the first use
+    TableFile & zone_file (TableFile &);
+    void build_zones (TableFile &);
+    // values of the fields widen the ranges of the zone of the record
+    void zone_add (TableFile &, unsigned long);
 public:
     Table () {}
     void create_table (string);
     void open_table (string);
     void delete_table (string);
+    TableFile & get_file (); // cached file of the opened table
+    // only these fields are read from the file by read_line
+    void use_fields (const vector <string> &);
+    void use_all_fields ();
+    void set_access (access_type); // hint for the next reading
+    // the value of the field of the record without reading all fields,
+    // the pointer is valid until the next change of the table
+    const char * value_ptr (const unsigned long, unsigned long);
+    long get_long (const unsigned long, unsigned long);
+    string get_text (const unsigned long, unsigned long);
     field_struct * get_field (const char [MAX_FIELD_NAME_LEN]);
+    unsigned long get_field_num (const char [MAX_FIELD_NAME_LEN]);
+    bool encoded (unsigned long); // the TEXT field keeps codes
+    const vector <string> & dict_values (unsigned long); // values by codes
     void add_line ();
     unsigned long find_line (); // find line number with the data
     void delete_line ();
+    void delete_line (const unsigned long); // mark the record as deleted
+    // mark all records with numbers in ascending order
+    void delete_lines (const vector <unsigned long> &);
+    bool need_vacuum (); // too many deleted records
+    unsigned long vacuum (); // remove deleted records from the file
+    // the same, the number of bytes the file lost is given too
+    unsigned long vacuum (unsigned long &);
+    // the table gets COMPRESSED_STORAGE if its data becomes smaller,
+    // the size of the data before and after compression is given
+    bool compress (unsigned long &, unsigned long &);
+    // the compressed table is decompressed before scanners of
+    // the statement which changes records are opened
+    void prepare_change ();
+    // statistics of fields are made again for changed zones,
+    // the numbers of such zones and of all zones are given
+    void analyze (unsigned long &, unsigned long &);
+    bool get_stats (unsigned long, column_stats &); // false without ANALYZE
     void update_line (const unsigned long);
+    // secondary indexes: name of the index and name of the field
+    // and bits of the Bloom filter of one zone for BLOOM_INDEX
+    void create_index (string, string, index_type, unsigned long);
+    index_struct * find_index (unsigned long, index_type); // NULL - none
+    // numbers of records with values of the field from the first
+    // to the second
+    void index_find (index_struct &, long, long, vector <unsigned long> &);
+    // numbers of records with the text in the field
+    void index_find (index_struct &, string, vector <unsigned long> &);
+    // numbers of records which can have all fragments in the field
+    void index_find (index_struct &, const vector <string> &, 
+                     vector <unsigned long> &);
+    // zones where the Bloom filters have none of the texts
+    void index_zones (index_struct &, const vector <string> &, 
+                      vector <bool> &);
+    // ranges of values of the LONG field in all zones
+    void zone_ranges (unsigned long, vector <zone_range> &);
     void read_first ();
     void read_line (const unsigned long);
     void read_next ();
@@ -98,10 +936,12 @@ public:
     void print_line_names (); // print names of fields
     void print_line (const unsigned long);
     void print_line (); // print line with the data
+    void print_fields (); // print data of the fields
     void print_table (); // print whole table
     // output not full lines
     void print_short_line_names (vector <string>);
     void print_short_line (vector <string>, unsigned long);
+    void print_short_fields (vector <string>);
     ~ Table () {}
 };
 
@@ -147,6 +987,21 @@ TableException :: TableException (table_exception_code errcode)
         case ESE_FILENAME:
             err_message = "ERROR: wrong table name lenth";
             break;
+        case ESE_VERSION:
+            err_message = "ERROR: old table format, use Convert";
+            break;
+        case ESE_INDEXNAME:
+            err_message = "ERROR: wrong index name";
+            break;
+        case ESE_FIELDTYPE:
+            err_message = "ERROR: wrong type of the field";
+            break;
+        case ESE_INDEXSIZE:
+            err_message = "ERROR: wrong size of the index";
+            break;
+        case ESE_DICTFULL:
+            err_message = "ERROR: too many values in the dictionary";
+            break;
     }
 }
 
@@ -160,9 +1015,15 @@ void TableException :: report ()
 TableClass :: TableClass ()
 {
     // setting initial values
+    memcpy (t_struct.magic, TABLE_MAGIC, TABLE_MAGIC_LEN);
+    t_struct.version = TABLE_VERSION;
     t_struct.num_of_fields = 0;
     t_struct.num_of_records = 0;
     t_struct.title_length = sizeof (struct table_struct);
+    t_struct.row_length = ROW_FLAG_LEN;
+    t_struct.storage = ROW_STORAGE;
+    t_struct.capacity = 0;
+    t_struct.num_of_deleted = 0;
 }
 
 void TableClass :: add_text (const char *f_name, const int f_length)
@@ -178,6 +1039,7 @@ void TableClass :: add_text (const char *f_name, const int f_length)
         f_struct.field_len = f_length;
         t_struct.num_of_fields += 1;
         t_struct.title_length += sizeof (struct field_struct);
+        t_struct.row_length += f_length;
         fields.push_back (f_struct);
     }
     else
@@ -198,6 +1060,7 @@ void TableClass :: add_long (const char *f_name)
         f_struct.field_len = sizeof (long);
         t_struct.num_of_fields += 1;
         t_struct.title_length += sizeof (struct field_struct);
+        t_struct.row_length += sizeof (long);
         fields.push_back (f_struct);
     }
     else
@@ -206,403 +1069,4502 @@ void TableClass :: add_long (const char *f_name)
     }
 }
 
-
-/*---------------Table---------------*/
-void Table :: create_table (string t_name)
+void TableClass :: add_dict_text (const char *f_name, const int f_length)
 {
-    if (t_name.length() > MAX_TABLE_NAME_LEN)
-    {
-        throw TableException (TableException :: ESE_FILENAME);
-    }
-    strcpy (t_struct.table_name, t_name.c_str());
-    string file_name = t_name + ".txt";
-    // if file exists, its content is deleting
-    FILE * f = fopen (file_name.c_str(), "wb+");
-    if (f == NULL)
-    {
-        throw TableException (TableException :: ESE_FILEOPEN);
-    }
-    // writing the main info about the table
-    if (fwrite (&(t_struct), sizeof (struct table_struct), 1, f) == 0)
-    {
-        throw TableException (TableException :: ESE_FILEWRITE);
-    }
-    // writing the info about all fields with empty data
-    // it's not a line of the table
-    // it's a part of title info
-    for (unsigned long i = 0; i < t_struct.num_of_fields; i++)
-    {
-        strcpy (fields[i].text, "");
-        fields[i].l_num = 0;
-        if (fwrite (&(fields[i]), sizeof (fields[i]), 1, f) == 0)
-        {
-            throw TableException (TableException :: ESE_FILEWRITE);
-        }
-    }
-    fclose (f);
+    add_text (f_name, f_length);
+    // the record keeps the code instead of the text
+    fields.back().l_num = DICT_CODE_LEN;
+    t_struct.row_length = t_struct.row_length - f_length + DICT_CODE_LEN;
 }
 
-void Table :: open_table (string t_name)
+void TableClass :: pack_line (char * buf)
 {
-    string file_name = t_name + ".txt";
-    // the file have to exist
-    FILE * f = fopen (file_name.c_str(), "rb");
-    if (f == NULL)
-    {
-        throw TableException (TableException :: ESE_FILEOPEN);
-    }
-    if (fseek (f, 0, SEEK_SET) != 0)
-    {
-        throw TableException (TableException :: ESE_FILESEEK);
-    }
-    // check if there is no any information
-    if (feof (f))
-    {
-        throw TableException (TableException :: ESE_EMPTYFILE);
-    }
-    // saving the info to the object info
-    if (fread (&(t_struct), sizeof (struct table_struct), 1, f) == 0)
-    {
-        throw TableException (TableException :: ESE_FILEREAD);
-    }
+    *buf = ROW_LIVE;
+    buf += ROW_FLAG_LEN;
     for (unsigned long i = 0; i < t_struct.num_of_fields; i++)
     {
-        struct field_struct f_struct;
-        if (fread (&(f_struct), sizeof(f_struct), 1, f) == 0)
+        if (fields[i].type == TEXT)
         {
-            throw TableException (TableException :: ESE_FILEREAD);
+            // the rest of the field is filled with zeros
+            strncpy (buf, fields[i].text, fields[i].field_len);
         }
-        fields.push_back (f_struct);
+        else
+        {
+            memcpy (buf, &(fields[i].l_num), sizeof (long));
+        }
+        buf += fields[i].field_len;
     }
-    fclose (f);
 }
 
-void Table :: delete_table (string t_name)
+void TableClass :: unpack_line (const char * buf)
 {
-    // cleaning any info about the table
-    t_struct.num_of_fields = 0;
-    t_struct.num_of_records = 0;
-    t_struct.title_length = sizeof (struct table_struct);
-    fields.clear();
-    string file_name = t_name + ".txt";
-    // deleting the file with data
-    if (remove (file_name.c_str()) != 0)
+    buf += ROW_FLAG_LEN;
+    for (unsigned long i = 0; i < t_struct.num_of_fields; i++)
     {
-        throw TableException (TableException :: ESE_FILEREMOVE);
+        unpack_field (i, buf);
+        buf += fields[i].field_len;
     }
 }
 
-field_struct * Table :: get_field (const char n [MAX_FIELD_NAME_LEN])
+void TableClass :: unpack_field (unsigned long i, const char * buf)
 {
-    unsigned long i = 0; 
-    while ((i < t_struct.num_of_fields) && 
-            (strcmp (n, fields[i].name) != 0))
-    {
-        i++;
-    }
-    // if there is no such field or if there is no any fields
-    if (i == t_struct.num_of_fields)
+    if (fields[i].type == TEXT)
     {
-        throw TableException (TableException :: ESE_FIELDNAME);
+        memset (fields[i].text, 0, MAX_TEXT_LEN);
+        memcpy (fields[i].text, buf, fields[i].field_len);
     }
     else
     {
-        return &fields[i];
+        memcpy (&(fields[i].l_num), buf, sizeof (long));
     }
 }
 
-void Table :: add_line ()
+
+/*---------------table_files---------------*/
+namespace table_files
 {
-    string t_name = string (t_struct.table_name, 
-                            strlen (t_struct.table_name));
-    string file_name = t_name + ".txt";
-    FILE * f = fopen (file_name.c_str(), "ab");
-    if (f == NULL)
-    {
-        throw TableException (TableException :: ESE_FILEOPEN);
-    }
-    for (unsigned long i = 0; i < t_struct.num_of_fields; i++)
+    TableFile & open (string t_name)
     {
-        if (fwrite (&(fields[i]), sizeof (fields[i]), 1, f) == 0)
+        string file_name = t_name + ".txt";
+        map <string, TableFile> :: iterator it = files.find (file_name);
+        // the file is already opened
+        if (it != files.end())
         {
-            throw TableException (TableException :: ESE_FILEWRITE);
+            return it -> second;
         }
-    }
-    fclose (f);
-    // changing the number of records in the table
-    t_struct.num_of_records += 1;
-    f = fopen (file_name.c_str(), "rb+");
-    if (f == NULL)
-    {
-        throw TableException (TableException :: ESE_FILEOPEN);
-    }
-    if (fseek (f, 0, SEEK_SET) != 0)
-    {
-        throw TableException (TableException :: ESE_FILESEEK);
-    }
-    if (fwrite (&(t_struct), sizeof (struct table_struct), 1, f) == 0)
-    {
-        throw TableException (TableException :: ESE_FILEWRITE);
-    }
-    fclose(f);
-
-}
-
-unsigned long Table :: find_line ()
-{
-    string t_name = string (t_struct.table_name, 
-                            strlen (t_struct.table_name));
-    string file_name = t_name + ".txt";
-    FILE * f = fopen (file_name.c_str(), "rb");
-    if (f == NULL)
-    {
-        throw TableException (TableException :: ESE_FILEOPEN);
-    }
-    unsigned long line_num = 0;
-    // lines counter
-    unsigned long j = 0;
-    if (fseek (f, t_struct.title_length, SEEK_SET) != 0)
-    {
-        throw TableException (TableException :: ESE_FILESEEK);
-    }
-    while (!line_num && (j < t_struct.num_of_records))
-    {
-        int flag_f = 1;
-        // fields counter
-        unsigned long i = 0;
-        while (i < t_struct.num_of_fields)
+        TableFile tf;
+        tf.name = file_name;
+        tf.map = NULL;
+        tf.map_len = 0;
+        tf.tail_pos = 0;
+        tf.title_dirty = false;
+        tf.unsynced = false;
+        tf.cached_zone = 0;
+        tf.free_known = false;
+        tf.analyzed = false;
+        // the file have to exist
+        tf.fd = :: open (file_name.c_str(), O_RDWR);
+        if (tf.fd == -1)
+        {
+            throw TableException (TableException :: ESE_FILEOPEN);
+        }
+        io_stats :: cur.opens++;
+        struct stat st;
+        if (fstat (tf.fd, &st) != 0)
+        {
+            :: close (tf.fd);
+            throw TableException (TableException :: ESE_FILEREAD);
+        }
+        // check if there is no any information
+        if (st.st_size == 0)
+        {
+            :: close (tf.fd);
+            throw TableException (TableException :: ESE_EMPTYFILE);
+        }
+        tf.file_len = st.st_size;
+        tf.disk_len = st.st_size;
+        map_file (tf);
+        try
         {
-            struct field_struct f_struct;
-            if (fread (&(f_struct), sizeof (f_struct), 1, f) == 0)
+            // saving the title to the cache
+            read_disk (tf, &(tf.t_struct), sizeof (struct table_struct), 0);
+            // files of the old format have to be converted first
+            if ((memcmp (tf.t_struct.magic, TABLE_MAGIC, TABLE_MAGIC_LEN) 
+                 != 0) || (tf.t_struct.version != TABLE_VERSION))
             {
-                throw TableException (TableException :: ESE_FILEREAD);
+                throw TableException (TableException :: ESE_VERSION);
             }
-            if (f_struct.type == TEXT)
+            // the fields are known from the catalog,
+            // tables made without it or with other storage are added there
+            catalog_table * ct = catalog :: find (t_name);
+            if ((ct != NULL) && 
+                (ct -> fields.size() == tf.t_struct.num_of_fields) && 
+                (ct -> entry.storage == tf.t_struct.storage))
             {
-                // if texts are not equal
-                if (strcmp (f_struct.text, fields[i].text))
-                {
-                    flag_f = 0;
-                }
+                tf.fields = ct -> fields;
             }
-            if (f_struct.type == LONG)
+            else
             {
-                // if numbers are not equal
-                if (f_struct.l_num != fields[i].l_num)
+                tf.fields.resize (tf.t_struct.num_of_fields);
+                if (tf.t_struct.num_of_fields != 0)
                 {
-                    flag_f = 0;
+                    read_disk (tf, &(tf.fields[0]), 
+                               sizeof (struct field_struct) * 
+                               tf.t_struct.num_of_fields, 
+                               sizeof (struct table_struct));
                 }
+                catalog :: add (tf.t_struct, tf.fields);
             }
-            i++;
+            load_indexes (tf);
+            load_dicts (tf);
+            tf.analyzed = exists (string (tf.t_struct.table_name) + ".stat");
         }
-        j++;
-        // if there is necessary line
-        if (flag_f)
+        catch (TableException &)
         {
-            line_num = j;
+            if (tf.map != NULL)
+            {
+                munmap (tf.map, tf.map_len);
+            }
+            :: close (tf.fd);
+            throw;
         }
+        set_offsets (tf);
+        tf.logged_title = tf.t_struct;
+        tf.id = ++last_id;
+        return files[file_name] = tf;
     }
-    fclose (f);
-    // if there is no necessary line
-    if (line_num == 0)
-    {
-        throw TableException (TableException :: ESE_LINEFIND);
-    }
-    else
+    
+    TableFile & create (string t_name, struct table_struct & t_struct,
+                        vector <field_struct> & fields)
     {
-        return line_num;
+        // the old file with such name and its indexes are not valid any more
+        close (t_name);
+        drop_side_files (t_name);
+        // the title is kept in the log before the old file is cut
+        vector <char> title (sizeof (struct table_struct) + 
+                             sizeof (struct field_struct) * 
+                             t_struct.num_of_fields);
+        memcpy (&(title[0]), &t_struct, sizeof (struct table_struct));
+        if (t_struct.num_of_fields != 0)
+        {
+            memcpy (&(title[sizeof (struct table_struct)]), &(fields[0]),
+                    sizeof (struct field_struct) * t_struct.num_of_fields);
+        }
+        string file_name = t_name + ".txt";
+        wal :: log_create (file_name, &(title[0]), title.size());
+        wal :: force ();
+        dropped.erase (file_name);
+        TableFile tf;
+        tf.name = file_name;
+        // if file exists, its content is deleting
+        tf.fd = :: open (file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 
+                         0644);
+        if (tf.fd == -1)
+        {
+            throw TableException (TableException :: ESE_FILEOPEN);
+        }
+        io_stats :: cur.opens++;
+        tf.file_len = 0;
+        tf.disk_len = 0;
+        tf.map = NULL;
+        tf.map_len = 0;
+        tf.tail_pos = 0;
+        tf.title_dirty = false;
+        tf.unsynced = true;
+        tf.t_struct = t_struct;
+        tf.logged_title = t_struct;
+        tf.fields = fields;
+        tf.dicts.resize (t_struct.num_of_fields);
+        tf.cached_zone = 0;
+        tf.free_known = false;
+        tf.analyzed = false;
+        tf.id = ++last_id;
+        set_offsets (tf);
+        map_file (tf);
+        // the pages of the pool refer to the file in the cache
+        TableFile & new_tf = files[file_name] = tf;
+        try
+        {
+            // writing the main info about the table
+            // and the info about all fields with empty data,
+            // it's not a line of the table, it's a part of title info
+            store_at (new_tf, &(title[0]), title.size(), 0);
+        }
+        catch (TableException &)
+        {
+            close (t_name);
+            throw;
+        }
+        return new_tf;
     }
-}
-
-void Table :: delete_line ()
-{
-    unsigned long line_num = find_line();
-    string t_name = string (t_struct.table_name, 
-                            strlen (t_struct.table_name));
-    string file_name = t_name + ".txt";
-    FILE * f = fopen (file_name.c_str(), "rb");
-    if (f == NULL)
+    
+    TableFile & open_data (string file_name, bool create)
     {
-        throw TableException (TableException :: ESE_FILEOPEN);
+        map <string, TableFile> :: iterator it = files.find (file_name);
+        if (it != files.end())
+        {
+            if (!create)
+            {
+                return it -> second;
+            }
+            close_file (file_name);
+        }
+        int flags = O_RDWR;
+        if (create)
+        {
+            // the log knows that the file was made empty
+            wal :: log_create (file_name, NULL, 0);
+            wal :: force ();
+            dropped.erase (file_name);
+            flags |= O_CREAT | O_TRUNC;
+        }
+        TableFile tf;
+        tf.name = file_name;
+        tf.fd = :: open (file_name.c_str(), flags, 0644);
+        if (tf.fd == -1)
+        {
+            throw TableException (TableException :: ESE_FILEOPEN);
+        }
+        io_stats :: cur.opens++;
+        struct stat st;
+        if (fstat (tf.fd, &st) != 0)
+        {
+            :: close (tf.fd);
+            throw TableException (TableException :: ESE_FILEREAD);
+        }
+        tf.file_len = st.st_size;
+        tf.disk_len = st.st_size;
+        tf.map = NULL;
+        tf.map_len = 0;
+        tf.tail_pos = 0;
+        tf.title_dirty = false;
+        tf.unsynced = create;
+        tf.cached_zone = 0;
+        tf.free_known = false;
+        tf.analyzed = false;
+        // such file has no title of the table
+        memset (&(tf.t_struct), 0, sizeof (struct table_struct));
+        tf.logged_title = tf.t_struct;
+        tf.id = ++last_id;
+        map_file (tf);
+        return files[file_name] = tf;
+    }
+    
+    void close (string t_name)
+    {
+        close_file (t_name + ".txt");
+    }
+    
+    void close_file (string file_name)
+    {
+        map <string, TableFile> :: iterator it = files.find (file_name);
+        if (it != files.end())
+        {
+            // changed data is written before closing
+            flush (it -> second);
+            buffer_pool :: drop (it -> second);
+            // the log can forget the changes of the closed file
+            if (wal :: enabled && it -> second.unsynced)
+            {
+                fdatasync (it -> second.fd);
+            }
+            if (it -> second.map != NULL)
+            {
+                munmap (it -> second.map, it -> second.map_len);
+            }
+            :: close (it -> second.fd);
+            io_stats :: cur.closes++;
+            files.erase (it);
+        }
+    }
+    
+    void close_all ()
+    {
+        while (!files.empty())
+        {
+            close_file (files.begin() -> first);
+        }
+    }
+    
+    void remove_file (string file_name)
+    {
+        close_file (file_name);
+        wal :: log_drop (file_name);
+        if (wal :: enabled)
+        {
+            dropped.insert (file_name);
+            return;
+        }
+        if ((remove (file_name.c_str()) != 0) && (errno != ENOENT))
+        {
+            throw TableException (TableException :: ESE_FILEREMOVE);
+        }
+    }
+    
+    // the statement waits for its commit here, so the files are removed
+    // before other statements can create files with the same names
+    void remove_dropped (unsigned long lsn)
+    {
+        if (dropped.empty())
+        {
+            return;
+        }
+        wal :: wait (lsn);
+        set <string> names = dropped;
+        dropped.clear();
+        set <string> :: iterator it;
+        for (it = names.begin(); it != names.end(); it++)
+        {
+            if ((remove (it -> c_str()) != 0) && (errno != ENOENT))
+            {
+                throw TableException (TableException :: ESE_FILEREMOVE);
+            }
+        }
+    }
+    
+    bool exists (string file_name)
+    {
+        return files.count (file_name) || 
+               (!dropped.count (file_name) && 
+                (access (file_name.c_str(), F_OK) == 0));
+    }
+    
+    // the list is kept opened with the table
+    void load_indexes (TableFile & tf)
+    {
+        string list_name = string (tf.t_struct.table_name) + ".ind";
+        tf.indexes.clear();
+        if (!exists (list_name))
+        {
+            return;
+        }
+        TableFile & ltf = open_data (list_name, false);
+        tf.indexes.resize (ltf.file_len / sizeof (struct index_struct));
+        if (!tf.indexes.empty())
+        {
+            read_at (ltf, &(tf.indexes[0]), sizeof (struct index_struct) * 
+                     tf.indexes.size(), 0);
+        }
+    }
+    
+    void save_indexes (TableFile & tf)
+    {
+        string list_name = string (tf.t_struct.table_name) + ".ind";
+        TableFile & ltf = open_data (list_name, !exists (list_name));
+        off_t len = sizeof (struct index_struct) * tf.indexes.size();
+        if (len > 0)
+        {
+            write_at (ltf, &(tf.indexes[0]), len, 0);
+        }
+        if (ltf.file_len > len)
+        {
+            resize (ltf, len);
+        }
+    }
+    
+    void drop_side_files (string t_name)
+    {
+        if (exists (t_name + ".zone"))
+        {
+            remove_file (t_name + ".zone");
+        }
+        if (exists (t_name + ".stat"))
+        {
+            remove_file (t_name + ".stat");
+        }
+        if (exists (t_name + ".dict"))
+        {
+            remove_file (t_name + ".dict");
+        }
+        string list_name = t_name + ".ind";
+        if (!exists (list_name))
+        {
+            return;
+        }
+        TableFile & ltf = open_data (list_name, false);
+        vector <index_struct> indexes (ltf.file_len / 
+                                       sizeof (struct index_struct));
+        if (!indexes.empty())
+        {
+            read_at (ltf, &(indexes[0]), sizeof (struct index_struct) * 
+                     indexes.size(), 0);
+        }
+        for (unsigned long i = 0; i < indexes.size(); i++)
+        {
+            remove_file (t_name + "." + indexes[i].name + ".idx");
+        }
+        remove_file (list_name);
+    }
+    
+    string index_file_name (TableFile & tf, index_struct & idx)
+    {
+        return string (tf.t_struct.table_name) + "." + idx.name + ".idx";
+    }
+    
+    // the dictionaries are kept in memory while the table is opened
+    void load_dicts (TableFile & tf)
+    {
+        string dict_name = string (tf.t_struct.table_name) + ".dict";
+        tf.dicts.clear();
+        tf.dicts.resize (tf.t_struct.num_of_fields);
+        if (!exists (dict_name))
+        {
+            return;
+        }
+        TableFile & dtf = open_data (dict_name, false);
+        vector <dict_entry> entries (dtf.file_len / 
+                                     sizeof (struct dict_entry));
+        if (!entries.empty())
+        {
+            read_at (dtf, &(entries[0]), sizeof (struct dict_entry) * 
+                     entries.size(), 0);
+        }
+        for (unsigned long i = 0; i < entries.size(); i++)
+        {
+            if (entries[i].field >= tf.dicts.size())
+            {
+                throw TableException (TableException :: ESE_FILEREAD);
+            }
+            dictionary & d = tf.dicts[entries[i].field];
+            string text (entries[i].text, strnlen (entries[i].text, 
+                                                   MAX_TEXT_LEN));
+            d.codes[text] = d.values.size();
+            d.values.push_back (text);
+        }
+    }
+    
+    void append_dict (TableFile & tf, unsigned long i, string text)
+    {
+        string dict_name = string (tf.t_struct.table_name) + ".dict";
+        TableFile & dtf = open_data (dict_name, !exists (dict_name));
+        dict_entry entry;
+        memset (&entry, 0, sizeof (struct dict_entry));
+        entry.field = i;
+        memcpy (entry.text, text.data(), 
+                min (text.size(), (size_t) MAX_TEXT_LEN));
+        write_at (dtf, &entry, sizeof (struct dict_entry), dtf.file_len);
+        tf.dicts[i].codes[text] = tf.dicts[i].values.size();
+        tf.dicts[i].values.push_back (text);
+    }
+    
+    void flush (TableFile & tf)
+    {
+        write_tail (tf);
+        buffer_pool :: flush (tf);
+        // the title is written after the records it counts
+        if (tf.title_dirty)
+        {
+            log_title (tf);
+            write_disk (tf, &(tf.t_struct), sizeof (struct table_struct), 0);
+            buffer_pool :: copy_in (tf, (const char *) &(tf.t_struct), 
+                                    sizeof (struct table_struct), 0);
+            tf.title_dirty = false;
+        }
+    }
+    
+    void flush_all ()
+    {
+        map <string, TableFile> :: iterator it;
+        for (it = files.begin(); it != files.end(); it++)
+        {
+            flush (it -> second);
+        }
+    }
+    
+    void sync_all ()
+    {
+        map <string, TableFile> :: iterator it;
+        for (it = files.begin(); it != files.end(); it++)
+        {
+            if (it -> second.unsynced)
+            {
+                if (fdatasync (it -> second.fd) != 0)
+                {
+                    throw TableException (TableException :: ESE_FILEWRITE);
+                }
+                it -> second.unsynced = false;
+            }
+        }
+    }
+    
+    void log_title (TableFile & tf)
+    {
+        if (memcmp (&(tf.logged_title), &(tf.t_struct), 
+                    sizeof (struct table_struct)) != 0)
+        {
+            wal :: log_write (tf, 0, sizeof (struct table_struct), 
+                              &(tf.t_struct), &(tf.logged_title));
+            tf.logged_title = tf.t_struct;
+        }
+    }
+    
+    void log_titles ()
+    {
+        map <string, TableFile> :: iterator it;
+        for (it = files.begin(); it != files.end(); it++)
+        {
+            log_title (it -> second);
+        }
+    }
+    
+    void read_at (TableFile & tf, void * buf, size_t len, off_t pos)
+    {
+        if (pos + (off_t) len > tf.file_len)
+        {
+            throw TableException (TableException :: ESE_FILEREAD);
+        }
+        // the pool does not know the data of the tail
+        if (!tf.tail.empty() && (pos + (off_t) len > tf.tail_pos))
+        {
+            write_tail (tf);
+        }
+        char * dst = (char *) buf;
+        while (len > 0)
+        {
+            unsigned long page = pos / POOL_PAGE_SIZE;
+            size_t shift = pos % POOL_PAGE_SIZE;
+            size_t part = POOL_PAGE_SIZE - shift;
+            if (part > len)
+            {
+                part = len;
+            }
+            memcpy (dst, buffer_pool :: get_page (tf, page, false) + shift,
+                    part);
+            dst += part;
+            pos += part;
+            len -= part;
+        }
+    }
+    
+    void write_at (TableFile & tf, const void * buf, size_t len, off_t pos)
+    {
+        if (wal :: enabled)
+        {
+            // the old data is kept for the rollback,
+            // there is nothing after the end of the file
+            vector <char> old (len, 0);
+            if (pos < tf.file_len)
+            {
+                size_t known = tf.file_len - pos;
+                if (known > len)
+                {
+                    known = len;
+                }
+                read_at (tf, &(old[0]), known, pos);
+            }
+            wal :: log_write (tf, pos, len, buf, &(old[0]));
+        }
+        store_at (tf, buf, len, pos);
+    }
+    
+    void store_at (TableFile & tf, const void * buf, size_t len, off_t pos)
+    {
+        const char * src = (const char *) buf;
+        if (!tf.tail.empty() && (pos + (off_t) len > tf.tail_pos))
+        {
+            write_tail (tf);
+        }
+        if (pos + (off_t) len > tf.file_len)
+        {
+            tf.file_len = pos + len;
+        }
+        while (len > 0)
+        {
+            unsigned long page = pos / POOL_PAGE_SIZE;
+            size_t shift = pos % POOL_PAGE_SIZE;
+            size_t part = POOL_PAGE_SIZE - shift;
+            if (part > len)
+            {
+                part = len;
+            }
+            memcpy (buffer_pool :: get_page (tf, page, true) + shift, src,
+                    part);
+            src += part;
+            pos += part;
+            len -= part;
+        }
+    }
+    
+    void append (TableFile & tf, const void * buf, size_t len)
+    {
+        if (tf.tail.empty())
+        {
+            tf.tail_pos = tf.file_len;
+        }
+        const char * src = (const char *) buf;
+        wal :: log_append (tf, tf.file_len, len, buf);
+        tf.tail.insert (tf.tail.end(), src, src + len);
+        tf.file_len += len;
+        if (tf.tail.size() >= APPEND_BUF_SIZE)
+        {
+            write_tail (tf);
+        }
+    }
+    
+    // the tail is written by one call
+    void write_tail (TableFile & tf)
+    {
+        if (tf.tail.empty())
+        {
+            return;
+        }
+        write_disk (tf, &(tf.tail[0]), tf.tail.size(), tf.tail_pos);
+        buffer_pool :: copy_in (tf, &(tf.tail[0]), tf.tail.size(), 
+                                tf.tail_pos);
+        tf.tail.clear();
+    }
+    
+    // new size of the file, the cut data is kept in the log
+    void resize (TableFile & tf, off_t len)
+    {
+        write_tail (tf);
+        vector <char> cut;
+        if (len < tf.file_len)
+        {
+            cut.resize (tf.file_len - len);
+            read_at (tf, &(cut[0]), cut.size(), len);
+        }
+        wal :: log_size (tf, tf.file_len, len, cut.empty() ? NULL : 
+                         &(cut[0]));
+        wal :: force ();
+        if (ftruncate (tf.fd, len) != 0)
+        {
+            throw TableException (TableException :: ESE_FILEWRITE);
+        }
+        tf.unsynced = true;
+        tf.file_len = len;
+        tf.disk_len = len;
+        if ((tf.map != NULL) && (tf.disk_len > (off_t) tf.map_len))
+        {
+            map_file (tf);
+        }
+    }
+    
+    const char * view (TableFile & tf, off_t pos, size_t len, char * buf)
+    {
+        if (!tf.tail.empty() && (pos + (off_t) len > tf.tail_pos))
+        {
+            write_tail (tf);
+        }
+        size_t shift = pos % POOL_PAGE_SIZE;
+        // the data lies in one page
+        if ((shift + len <= POOL_PAGE_SIZE) && 
+            (pos + (off_t) len <= tf.file_len))
+        {
+            return buffer_pool :: get_page (tf, pos / POOL_PAGE_SIZE, false)
+                   + shift;
+        }
+        read_at (tf, buf, len, pos);
+        return buf;
+    }
+    
+    void read_disk (TableFile & tf, void * buf, size_t len, off_t pos)
+    {
+        // the data is copied from the mapping without system calls
+        if ((tf.map != NULL) && (pos + (off_t) len <= tf.disk_len))
+        {
+            memcpy (buf, tf.map + pos, len);
+            return;
+        }
+        io_stats :: cur.reads++;
+        if (pread (tf.fd, buf, len, pos) != (ssize_t) len)
+        {
+            throw TableException (TableException :: ESE_FILEREAD);
+        }
+    }
+    
+    void read_direct (TableFile & tf, void * buf, size_t len, off_t pos)
+    {
+        size_t disk_part = len;
+        if (!tf.tail.empty() && (pos + (off_t) len > tf.tail_pos))
+        {
+            disk_part = 0;
+            if (tf.tail_pos > pos)
+            {
+                disk_part = tf.tail_pos - pos;
+            }
+            memcpy ((char *) buf + disk_part, 
+                    &(tf.tail[pos + disk_part - tf.tail_pos]), 
+                    len - disk_part);
+        }
+        if (disk_part > 0)
+        {
+            read_disk (tf, buf, disk_part, pos);
+        }
+    }
+    
+    void write_disk (TableFile & tf, const void * buf, size_t len, 
+                     off_t pos)
+    {
+        // the changes are in the log before they are in the file
+        wal :: force ();
+        tf.unsynced = true;
+        io_stats :: cur.writes++;
+        if (pwrite (tf.fd, buf, len, pos) != (ssize_t) len)
+        {
+            throw TableException (TableException :: ESE_FILEWRITE);
+        }
+        if (pos + (off_t) len > tf.disk_len)
+        {
+            tf.disk_len = pos + len;
+            // the new end of the file is out of the mapping
+            if ((tf.map != NULL) && (tf.disk_len > (off_t) tf.map_len))
+            {
+                map_file (tf);
+            }
+        }
+    }
+    
+    // copy len bytes from the position from to the position to,
+    // the places can overlap
+    void move_data (TableFile & tf, off_t from, off_t to, size_t len)
+    {
+        vector <char> buf (MOVE_BUF_SIZE);
+        size_t done = 0;
+        while (done < len)
+        {
+            size_t part = len - done;
+            if (part > MOVE_BUF_SIZE)
+            {
+                part = MOVE_BUF_SIZE;
+            }
+            // moving to the end of the file begins from the last part
+            off_t pos = done;
+            if (to > from)
+            {
+                pos = len - done - part;
+            }
+            read_at (tf, &(buf[0]), part, from + pos);
+            write_at (tf, &(buf[0]), part, to + pos);
+            done += part;
+        }
+    }
+    
+    void set_offsets (TableFile & tf)
+    {
+        unsigned long pos = ROW_FLAG_LEN;
+        tf.offsets.clear();
+        tf.widths.clear();
+        for (unsigned long i = 0; i < tf.t_struct.num_of_fields; i++)
+        {
+            tf.offsets.push_back (pos);
+            // the code of the dictionary instead of the text
+            if ((tf.fields[i].type == TEXT) && (tf.fields[i].l_num != 0))
+            {
+                tf.widths.push_back (tf.fields[i].l_num);
+            }
+            else
+            {
+                tf.widths.push_back (tf.fields[i].field_len);
+            }
+            pos += tf.widths[i];
+        }
+        tf.line.resize (tf.t_struct.row_length);
+    }
+    
+    // the mapping is bigger than the file, so appending records 
+    // does not need new mapping every time
+    void map_file (TableFile & tf)
+    {
+        if (tf.map != NULL)
+        {
+            munmap (tf.map, tf.map_len);
+        }
+        tf.map_len = (tf.disk_len / MAP_STEP + 1) * MAP_STEP;
+        io_stats :: cur.maps++;
+        void * p = mmap (NULL, tf.map_len, PROT_READ, MAP_SHARED, tf.fd, 0);
+        // without the mapping the file is read with pread
+        if (p == MAP_FAILED)
+        {
+            tf.map = NULL;
+            tf.map_len = 0;
+        }
+        else
+        {
+            tf.map = (char *) p;
+        }
+    }
+    
+    void advise (TableFile & tf, access_type acc)
+    {
+        if (tf.map == NULL)
+        {
+            return;
+        }
+        int advice = MADV_NORMAL;
+        if (acc == SEQUENTIAL_ACCESS)
+        {
+            advice = MADV_SEQUENTIAL;
+        }
+        else if (acc == RANDOM_ACCESS)
+        {
+            advice = MADV_RANDOM;
+        }
+        madvise (tf.map, tf.map_len, advice);
+    }
+} // end of namespace table_files
+
+
+/*---------------catalog---------------*/
+namespace catalog
+{
+    void load ()
+    {
+        if (loaded)
+        {
+            return;
+        }
+        loaded = true;
+        tables.clear();
+        if (!table_files :: exists (CATALOG_FILE))
+        {
+            DIR * dir = opendir (".");
+            if (dir == NULL)
+            {
+                return;
+            }
+            struct dirent * d;
+            while ((d = readdir (dir)) != NULL)
+            {
+                string file_name = d -> d_name;
+                if ((file_name.size() <= 4) || 
+                    (file_name.substr (file_name.size() - 4) != ".txt"))
+                {
+                    continue;
+                }
+                struct table_struct t_struct;
+                vector <field_struct> fields;
+                string t_name = file_name.substr (0, file_name.size() - 4);
+                if ((t_name.size() <= MAX_TABLE_NAME_LEN) && 
+                    read_title (file_name, t_struct, fields))
+                {
+                    add (t_struct, fields);
+                }
+            }
+            closedir (dir);
+            if (!tables.empty())
+            {
+                save ();
+            }
+            return;
+        }
+        TableFile & ctf = table_files :: open_data (CATALOG_FILE, false);
+        vector <char> data (ctf.file_len);
+        if (!data.empty())
+        {
+            table_files :: read_at (ctf, &(data[0]), data.size(), 0);
+        }
+        size_t pos = 0;
+        while (pos < data.size())
+        {
+            catalog_table ct;
+            if (pos + sizeof (struct catalog_entry) > data.size())
+            {
+                throw TableException (TableException :: ESE_FILEREAD);
+            }
+            memcpy (&(ct.entry), &(data[pos]), sizeof (struct catalog_entry));
+            pos += sizeof (struct catalog_entry);
+            if (ct.entry.num_of_fields > (data.size() - pos) / 
+                                         sizeof (struct field_struct))
+            {
+                throw TableException (TableException :: ESE_FILEREAD);
+            }
+            ct.fields.resize (ct.entry.num_of_fields);
+            if (!ct.fields.empty())
+            {
+                memcpy (&(ct.fields[0]), &(data[pos]), 
+                        sizeof (struct field_struct) * ct.fields.size());
+            }
+            pos += sizeof (struct field_struct) * ct.fields.size();
+            tables[ct.entry.table_name] = ct;
+        }
+    }
+    
+    void save ()
+    {
+        vector <char> data;
+        map <string, catalog_table> :: iterator it;
+        for (it = tables.begin(); it != tables.end(); it++)
+        {
+            const char * entry = (const char *) &(it -> second.entry);
+            data.insert (data.end(), entry, 
+                         entry + sizeof (struct catalog_entry));
+            if (!it -> second.fields.empty())
+            {
+                const char * fields = (const char *) &(it -> second.
+                                                       fields[0]);
+                data.insert (data.end(), fields, fields + 
+                             sizeof (struct field_struct) * 
+                             it -> second.fields.size());
+            }
+        }
+        bool fresh = !table_files :: exists (CATALOG_FILE);
+        TableFile & ctf = table_files :: open_data (CATALOG_FILE, fresh);
+        if (!data.empty())
+        {
+            table_files :: write_at (ctf, &(data[0]), data.size(), 0);
+        }
+        table_files :: resize (ctf, data.size());
+        // without the log the catalog is written at once
+        if (!wal :: enabled)
+        {
+            table_files :: flush (ctf);
+        }
+    }
+    
+    void add (struct table_struct & t_struct, vector <field_struct> & fields)
+    {
+        load ();
+        catalog_table ct;
+        memset (&(ct.entry), 0, sizeof (struct catalog_entry));
+        string t_name (t_struct.table_name, strnlen (t_struct.table_name, 
+                                                     MAX_TABLE_NAME_LEN));
+        strcpy (ct.entry.table_name, t_name.c_str());
+        strcpy (ct.entry.file_name, (t_name + ".txt").c_str());
+        ct.entry.storage = t_struct.storage;
+        ct.entry.num_of_fields = fields.size();
+        ct.fields = fields;
+        tables[t_name] = ct;
+        save ();
+    }
+    
+    void remove (string t_name)
+    {
+        load ();
+        if (tables.erase (t_name) != 0)
+        {
+            save ();
+        }
+    }
+    
+    catalog_table * find (string t_name)
+    {
+        load ();
+        map <string, catalog_table> :: iterator it = tables.find (t_name);
+        if (it == tables.end())
+        {
+            return NULL;
+        }
+        return &(it -> second);
+    }
+    
+    bool read_title (string file_name, struct table_struct & t_struct,
+                     vector <field_struct> & fields)
+    {
+        FILE * f = fopen (file_name.c_str(), "rb");
+        if (f == NULL)
+        {
+            return false;
+        }
+        bool valid = (fread (&t_struct, sizeof (t_struct), 1, f) == 1) &&
+                     (memcmp (t_struct.magic, TABLE_MAGIC, TABLE_MAGIC_LEN) 
+                      == 0) && (t_struct.version == TABLE_VERSION) &&
+                     (t_struct.num_of_fields < 
+                      (1UL << 16) / sizeof (struct field_struct));
+        if (valid)
+        {
+            fields.resize (t_struct.num_of_fields);
+            valid = fields.empty() || 
+                    (fread (&(fields[0]), sizeof (struct field_struct), 
+                            fields.size(), f) == fields.size());
+        }
+        fclose (f);
+        return valid;
+    }
+} // end of namespace catalog
+
+
+/*---------------buffer_pool---------------*/
+namespace buffer_pool
+{
+    void set_capacity (unsigned long num)
+    {
+        flush_all ();
+        if (num == 0)
+        {
+            num = 1;
+        }
+        capacity = num;
+        data.clear();
+        frames.clear();
+        lru.clear();
+        lru_pos.clear();
+        free_frames.clear();
+        pages.clear();
+    }
+    
+    char * get_page (TableFile & tf, unsigned long page, bool for_write)
+    {
+        // the pool is created with the first page
+        if (frames.empty())
+        {
+            data.resize (capacity * POOL_PAGE_SIZE);
+            page_frame empty_frame = {NULL, 0, false};
+            frames.assign (capacity, empty_frame);
+            lru_pos.resize (capacity);
+            for (unsigned long i = capacity; i > 0; i--)
+            {
+                free_frames.push_back (i - 1);
+            }
+        }
+        pair <unsigned long, unsigned long> key (tf.id, page);
+        map <pair <unsigned long, unsigned long>, unsigned long> :: iterator
+            it = pages.find (key);
+        unsigned long fr;
+        if (it != pages.end())
+        {
+            io_stats :: cur.hits++;
+            fr = it -> second;
+            // the page becomes the most recently used
+            lru.splice (lru.begin(), lru, lru_pos[fr]);
+        }
+        else
+        {
+            io_stats :: cur.misses++;
+            if (free_frames.empty())
+            {
+                // replacing the least recently used page
+                fr = lru.back();
+                io_stats :: cur.evictions++;
+                if (frames[fr].dirty)
+                {
+                    write_back (fr);
+                }
+                pages.erase (make_pair (frames[fr].file -> id, 
+                                        frames[fr].page));
+                lru.pop_back();
+            }
+            else
+            {
+                fr = free_frames.back();
+                free_frames.pop_back();
+            }
+            char * buf = &(data[fr * POOL_PAGE_SIZE]);
+            off_t pos = (off_t) page * POOL_PAGE_SIZE;
+            // the part of the page after the end of the file is empty
+            size_t len = 0;
+            if (tf.disk_len > pos)
+            {
+                len = tf.disk_len - pos;
+                if (len > POOL_PAGE_SIZE)
+                {
+                    len = POOL_PAGE_SIZE;
+                }
+                table_files :: read_disk (tf, buf, len, pos);
+            }
+            memset (buf + len, 0, POOL_PAGE_SIZE - len);
+            frames[fr].file = &tf;
+            frames[fr].page = page;
+            frames[fr].dirty = false;
+            pages[key] = fr;
+            lru.push_front (fr);
+            lru_pos[fr] = lru.begin();
+        }
+        if (for_write)
+        {
+            frames[fr].dirty = true;
+        }
+        return &(data[fr * POOL_PAGE_SIZE]);
+    }
+    
+    void write_back (unsigned long fr)
+    {
+        TableFile & tf = *(frames[fr].file);
+        off_t pos = (off_t) frames[fr].page * POOL_PAGE_SIZE;
+        // only the part before the end of the file is written
+        if (tf.file_len > pos)
+        {
+            size_t len = tf.file_len - pos;
+            if (len > POOL_PAGE_SIZE)
+            {
+                len = POOL_PAGE_SIZE;
+            }
+            io_stats :: cur.write_backs++;
+            table_files :: write_disk (tf, &(data[fr * POOL_PAGE_SIZE]), 
+                                       len, pos);
+        }
+        frames[fr].dirty = false;
+    }
+    
+    void flush (TableFile & tf)
+    {
+        map <pair <unsigned long, unsigned long>, unsigned long> :: iterator
+            it = pages.lower_bound (make_pair (tf.id, 0UL));
+        // pages of the file are written in the order of their places
+        while ((it != pages.end()) && (it -> first.first == tf.id))
+        {
+            if (frames[it -> second].dirty)
+            {
+                write_back (it -> second);
+            }
+            it++;
+        }
+    }
+    
+    void flush_all ()
+    {
+        map <pair <unsigned long, unsigned long>, unsigned long> :: iterator
+            it;
+        for (it = pages.begin(); it != pages.end(); it++)
+        {
+            if (frames[it -> second].dirty)
+            {
+                write_back (it -> second);
+            }
+        }
+    }
+    
+    void copy_in (TableFile & tf, const char * buf, size_t len, off_t pos)
+    {
+        while (len > 0)
+        {
+            unsigned long page = pos / POOL_PAGE_SIZE;
+            size_t shift = pos % POOL_PAGE_SIZE;
+            size_t part = POOL_PAGE_SIZE - shift;
+            if (part > len)
+            {
+                part = len;
+            }
+            map <pair <unsigned long, unsigned long>, unsigned long> :: 
+                iterator it = pages.find (make_pair (tf.id, page));
+            if (it != pages.end())
+            {
+                memcpy (&(data[it -> second * POOL_PAGE_SIZE]) + shift, buf,
+                        part);
+            }
+            buf += part;
+            pos += part;
+            len -= part;
+        }
+    }
+    
+    void drop (TableFile & tf)
+    {
+        map <pair <unsigned long, unsigned long>, unsigned long> :: iterator
+            it = pages.lower_bound (make_pair (tf.id, 0UL));
+        while ((it != pages.end()) && (it -> first.first == tf.id))
+        {
+            unsigned long fr = it -> second;
+            frames[fr].file = NULL;
+            frames[fr].dirty = false;
+            lru.erase (lru_pos[fr]);
+            free_frames.push_back (fr);
+            pages.erase (it++);
+        }
+    }
+} // end of namespace buffer_pool
+
+
+/*---------------io_stats---------------*/
+namespace io_stats
+{
+    void start_statement ()
+    {
+        total.opens += cur.opens;
+        total.closes += cur.closes;
+        total.reads += cur.reads;
+        total.writes += cur.writes;
+        total.maps += cur.maps;
+        total.hits += cur.hits;
+        total.misses += cur.misses;
+        total.evictions += cur.evictions;
+        total.write_backs += cur.write_backs;
+        total.scan_blocks += cur.scan_blocks;
+        total.zone_skips += cur.zone_skips;
+        total.cache_hits += cur.cache_hits;
+        total.cache_misses += cur.cache_misses;
+        total.cache_evictions += cur.cache_evictions;
+        // the writer of the log changes its counter
+        lock_guard <mutex> lock (wal :: log_lock);
+        total.log_syncs += cur.log_syncs;
+        struct io_counters zero = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+        cur = zero;
+    }
+    
+    // print one counter for the last statement and for the whole work
+    void print_counter (const char * name, unsigned long last, 
+                        unsigned long all)
+    {
+        cout.width (MAX_FIELD_NAME_LEN + 2);
+        cout << name;
+        cout.width (MAX_FIELD_NAME_LEN + 2);
+        cout << last;
+        cout.width (MAX_FIELD_NAME_LEN + 2);
+        cout << all + last;
+        cout.width (0);
+        cout << endl;
+    }
+    
+    void print ()
+    {
+        cout.width (MAX_FIELD_NAME_LEN + 2);
+        cout << "counter";
+        cout.width (MAX_FIELD_NAME_LEN + 2);
+        cout << "last statement";
+        cout.width (MAX_FIELD_NAME_LEN + 2);
+        cout << "total";
+        cout.width (0);
+        cout << endl;
+        print_counter ("open", cur.opens, total.opens);
+        print_counter ("close", cur.closes, total.closes);
+        print_counter ("pread", cur.reads, total.reads);
+        print_counter ("pwrite", cur.writes, total.writes);
+        print_counter ("mmap", cur.maps, total.maps);
+        print_counter ("pool hit", cur.hits, total.hits);
+        print_counter ("pool miss", cur.misses, total.misses);
+        print_counter ("pool eviction", cur.evictions, total.evictions);
+        print_counter ("page write", cur.write_backs, total.write_backs);
+        print_counter ("scan block", cur.scan_blocks, total.scan_blocks);
+        print_counter ("zone skip", cur.zone_skips, total.zone_skips);
+        print_counter ("cache hit", cur.cache_hits, total.cache_hits);
+        print_counter ("cache miss", cur.cache_misses, total.cache_misses);
+        print_counter ("cache eviction", cur.cache_evictions, 
+                       total.cache_evictions);
+        lock_guard <mutex> lock (wal :: log_lock);
+        print_counter ("log fsync", cur.log_syncs, total.log_syncs);
+    }
+} // end of namespace io_stats
+
+
+/*---------------wal---------------*/
+namespace wal
+{
+    void start ()
+    {
+        fd = :: open (WAL_FILE, O_RDWR | O_CREAT | O_APPEND, 0644);
+        if (fd == -1)
+        {
+            throw TableException (TableException :: ESE_FILEOPEN);
+        }
+        recover ();
+        enabled = true;
+        stopping = false;
+        writer = thread (write_loop);
+        checkpointer = thread (checkpoint_loop);
+    }
+    
+    void stop ()
+    {
+        if (!enabled)
+        {
+            return;
+        }
+        // the tables get all changes, the log stays empty
+        try
+        {
+            checkpoint ();
+        }
+        catch (TableException &)
+        {
+            // the log stays for the recovery at the next start
+        }
+        {
+            lock_guard <mutex> lock (log_lock);
+            stopping = true;
+        }
+        write_cond.notify_all ();
+        checkpoint_cond.notify_all ();
+        writer.join ();
+        checkpointer.join ();
+        enabled = false;
+        :: close (fd);
+        fd = -1;
+    }
+    
+    void begin ()
+    {
+        txn++;
+        txn_changed = false;
+        lock_guard <mutex> lock (log_lock);
+        txn_lsn = next_lsn;
+    }
+    
+    unsigned long commit ()
+    {
+        if (!enabled)
+        {
+            return 0;
+        }
+        // the titles changed without writing the files
+        table_files :: log_titles ();
+        // the statement without changes has nothing to wait for
+        if (!txn_changed)
+        {
+            return 0;
+        }
+        wal_record rec;
+        fill (rec, WAL_COMMIT, "", 0, 0);
+        add (rec, NULL, 0, NULL, 0);
+        lock_guard <mutex> lock (log_lock);
+        return next_lsn;
+    }
+    
+    // the files are closed, so all changes and titles of the statement
+    // are in the log and in the files, then the records of the statement
+    // are read back from the log and undone in the reverse order
+    void rollback ()
+    {
+        if (!enabled)
+        {
+            return;
+        }
+        table_files :: dropped.clear();
+        table_files :: close_all ();
+        if (!txn_changed)
+        {
+            return;
+        }
+        force ();
+        vector <char> data;
+        {
+            lock_guard <mutex> lock (log_lock);
+            data.resize (next_lsn - txn_lsn);
+            if (pread (fd, &(data[0]), data.size(), 
+                       log_len - data.size()) != (ssize_t) data.size())
+            {
+                throw TableException (TableException :: ESE_FILEREAD);
+            }
+        }
+        vector <size_t> places;
+        size_t pos = 0;
+        while (pos < data.size())
+        {
+            places.push_back (pos);
+            wal_record rec;
+            memcpy (&rec, &(data[pos]), sizeof (struct wal_record));
+            pos += sizeof (struct wal_record) + rec.data_len;
+        }
+        map <string, int> fds;
+        set <string> tables; // names of the changed tables
+        for (size_t i = places.size(); i > 0; i--)
+        {
+            wal_record rec;
+            memcpy (&rec, &(data[places[i - 1]]), sizeof (struct wal_record));
+            undo (fds, rec, &(data[places[i - 1] + 
+                                   sizeof (struct wal_record)]));
+            string file_name = rec.file_name;
+            if ((file_name.length() > 4) && 
+                (file_name.substr (file_name.length() - 4) == ".txt"))
+            {
+                tables.insert (file_name.substr (0, file_name.length() - 4));
+            }
+        }
+        map <string, int> :: iterator it;
+        for (it = fds.begin(); it != fds.end(); it++)
+        {
+            fdatasync (it -> second);
+            :: close (it -> second);
+        }
+        // the catalog forgets created tables, other tables get their
+        // entries from the titles again when they are opened
+        set <string> :: iterator t;
+        for (t = tables.begin(); t != tables.end(); t++)
+        {
+            if (table_files :: exists (*t + ".txt"))
+            {
+                table_files :: open (*t);
+            }
+            else
+            {
+                catalog :: remove (*t);
+            }
+        }
+        // recovery undoes the statement at this place of the log again,
+        // so later statements keep their changes
+        wal_record rec;
+        fill (rec, WAL_ABORT, "", 0, 0);
+        add (rec, NULL, 0, NULL, 0);
+        txn_changed = false;
+    }
+    
+    void wait (unsigned long lsn)
+    {
+        unique_lock <mutex> lock (log_lock);
+        if (durable_lsn >= lsn)
+        {
+            return;
+        }
+        write_cond.notify_one ();
+        while ((durable_lsn < lsn) && !failed)
+        {
+            durable_cond.wait (lock);
+        }
+        if (durable_lsn < lsn)
+        {
+            throw TableException (TableException :: ESE_FILEWRITE);
+        }
+    }
+    
+    void force ()
+    {
+        if (!enabled)
+        {
+            return;
+        }
+        unsigned long lsn;
+        {
+            lock_guard <mutex> lock (log_lock);
+            lsn = next_lsn;
+        }
+        wait (lsn);
+    }
+    
+    // all tables are written and synced, then the log is emptied
+    void checkpoint ()
+    {
+        lock_guard <mutex> db (db_lock);
+        table_files :: flush_all ();
+        force ();
+        table_files :: sync_all ();
+        lock_guard <mutex> lock (log_lock);
+        if ((ftruncate (fd, 0) != 0) || (fdatasync (fd) != 0))
+        {
+            throw TableException (TableException :: ESE_FILEWRITE);
+        }
+        log_len = 0;
+    }
+    
+    // the file for the recovery, -1 if there is no such file
+    int recovery_file (map <string, int> & fds, string file_name)
+    {
+        map <string, int> :: iterator it = fds.find (file_name);
+        if (it != fds.end())
+        {
+            return it -> second;
+        }
+        int t_fd = :: open (file_name.c_str(), O_RDWR);
+        if (t_fd != -1)
+        {
+            fds[file_name] = t_fd;
+        }
+        return t_fd;
+    }
+    
+    void recover ()
+    {
+        struct stat st;
+        if (fstat (fd, &st) != 0)
+        {
+            throw TableException (TableException :: ESE_FILEREAD);
+        }
+        if (st.st_size == 0)
+        {
+            return;
+        }
+        vector <char> data (st.st_size);
+        if (pread (fd, &(data[0]), data.size(), 0) != st.st_size)
+        {
+            throw TableException (TableException :: ESE_FILEREAD);
+        }
+        // records are taken while they are whole,
+        // the last one can be written partly
+        vector <size_t> places;
+        set <unsigned long> committed;
+        set <unsigned long> aborted;
+        size_t pos = 0;
+        while (pos + sizeof (struct wal_record) <= data.size())
+        {
+            wal_record rec;
+            memcpy (&rec, &(data[pos]), sizeof (struct wal_record));
+            if (pos + sizeof (struct wal_record) + rec.data_len > 
+                data.size())
+            {
+                break;
+            }
+            unsigned long check = rec.check;
+            rec.check = 0;
+            if (sum (&(data[pos + sizeof (struct wal_record)]), 
+                     rec.data_len, sum (&rec, sizeof (rec), 0)) != check)
+            {
+                break;
+            }
+            places.push_back (pos);
+            if (rec.type == WAL_COMMIT)
+            {
+                committed.insert (rec.txn);
+            }
+            else if (rec.type == WAL_ABORT)
+            {
+                aborted.insert (rec.txn);
+            }
+            pos += sizeof (struct wal_record) + rec.data_len;
+        }
+        map <string, int> fds;
+        // committed changes are repeated in the order of the log,
+        // files are created and removed as it was done, the failed
+        // statement is undone at the place of its abort
+        for (size_t i = 0; i < places.size(); i++)
+        {
+            wal_record rec;
+            memcpy (&rec, &(data[places[i]]), sizeof (struct wal_record));
+            const char * d = &(data[places[i] + sizeof (struct wal_record)]);
+            string file_name = rec.file_name;
+            if (rec.type == WAL_ABORT)
+            {
+                for (size_t j = i; j > 0; j--)
+                {
+                    wal_record old;
+                    memcpy (&old, &(data[places[j - 1]]), 
+                            sizeof (struct wal_record));
+                    if (old.txn == rec.txn)
+                    {
+                        undo (fds, old, &(data[places[j - 1] + 
+                                               sizeof (struct wal_record)]));
+                    }
+                }
+                continue;
+            }
+            if (!committed.count (rec.txn))
+            {
+                continue;
+            }
+            if ((rec.type == WAL_CREATE) || (rec.type == WAL_DROP))
+            {
+                map <string, int> :: iterator it = fds.find (file_name);
+                if (it != fds.end())
+                {
+                    :: close (it -> second);
+                    fds.erase (it);
+                }
+                if (rec.type == WAL_DROP)
+                {
+                    remove (file_name.c_str());
+                    continue;
+                }
+                int t_fd = :: open (file_name.c_str(), 
+                                 O_RDWR | O_CREAT | O_TRUNC, 0644);
+                if ((t_fd == -1) || 
+                    (pwrite (t_fd, d, rec.len, 0) != (ssize_t) rec.len))
+                {
+                    throw TableException (TableException :: ESE_FILEWRITE);
+                }
+                fds[file_name] = t_fd;
+                continue;
+            }
+            int t_fd = recovery_file (fds, file_name);
+            if (t_fd == -1)
+            {
+                continue;
+            }
+            bool ok = true;
+            if ((rec.type == WAL_WRITE) || (rec.type == WAL_APPEND))
+            {
+                ok = pwrite (t_fd, d, rec.len, rec.pos) == (ssize_t) rec.len;
+            }
+            else if (rec.type == WAL_SIZE)
+            {
+                ok = ftruncate (t_fd, rec.len) == 0;
+            }
+            if (!ok)
+            {
+                throw TableException (TableException :: ESE_FILEWRITE);
+            }
+        }
+        // changes of the unfinished statement are rolled back
+        for (size_t i = places.size(); i > 0; i--)
+        {
+            wal_record rec;
+            memcpy (&rec, &(data[places[i - 1]]), sizeof (struct wal_record));
+            if (!committed.count (rec.txn) && !aborted.count (rec.txn))
+            {
+                undo (fds, rec, &(data[places[i - 1] + 
+                                       sizeof (struct wal_record)]));
+            }
+        }
+        map <string, int> :: iterator it;
+        for (it = fds.begin(); it != fds.end(); it++)
+        {
+            fdatasync (it -> second);
+            :: close (it -> second);
+        }
+        if ((ftruncate (fd, 0) != 0) || (fdatasync (fd) != 0))
+        {
+            throw TableException (TableException :: ESE_FILEWRITE);
+        }
+    }
+    
+    // files created by the statement are removed,
+    // dropped files weren't removed before the commit
+    void undo (map <string, int> & fds, wal_record & rec, const char * d)
+    {
+        if (rec.type == WAL_CREATE)
+        {
+            map <string, int> :: iterator it = fds.find (rec.file_name);
+            if (it != fds.end())
+            {
+                :: close (it -> second);
+                fds.erase (it);
+            }
+            if ((remove (rec.file_name) != 0) && (errno != ENOENT))
+            {
+                throw TableException (TableException :: ESE_FILEREMOVE);
+            }
+            return;
+        }
+        if ((rec.type != WAL_WRITE) && (rec.type != WAL_APPEND) && 
+            (rec.type != WAL_SIZE))
+        {
+            return;
+        }
+        int t_fd = recovery_file (fds, rec.file_name);
+        if (t_fd == -1)
+        {
+            return;
+        }
+        bool ok = true;
+        if (rec.type == WAL_WRITE)
+        {
+            ok = pwrite (t_fd, d + rec.len, rec.len, rec.pos) == 
+                 (ssize_t) rec.len;
+        }
+        else if (rec.type == WAL_APPEND)
+        {
+            ok = ftruncate (t_fd, rec.pos) == 0;
+        }
+        else if (rec.type == WAL_SIZE)
+        {
+            ok = ftruncate (t_fd, rec.pos) == 0;
+            if (ok && (rec.data_len > 0))
+            {
+                ok = pwrite (t_fd, d, rec.data_len, rec.len) == 
+                     (ssize_t) rec.data_len;
+            }
+        }
+        if (!ok)
+        {
+            throw TableException (TableException :: ESE_FILEWRITE);
+        }
+    }
+    
+    // FNV-1a hash for checking records
+    unsigned long sum (const void * data, size_t len, unsigned long h)
+    {
+        if (h == 0)
+        {
+            h = 14695981039346656037UL;
+        }
+        const unsigned char * p = (const unsigned char *) data;
+        for (size_t i = 0; i < len; i++)
+        {
+            h ^= p[i];
+            h *= 1099511628211UL;
+        }
+        return h;
+    }
+    
+    void fill (wal_record & rec, wal_record_type type, string file_name, 
+               unsigned long pos, unsigned long len)
+    {
+        // the gaps of the structure take part in the sum
+        memset (&rec, 0, sizeof (struct wal_record));
+        rec.type = type;
+        rec.txn = txn;
+        strncpy (rec.file_name, file_name.c_str(), MAX_FILE_NAME_LEN);
+        rec.pos = pos;
+        rec.len = len;
+    }
+    
+    void add (wal_record & rec, const void * data1, size_t len1, 
+              const void * data2, size_t len2)
+    {
+        rec.data_len = len1 + len2;
+        rec.check = sum (data2, len2, sum (data1, len1, 
+                                           sum (&rec, sizeof (rec), 0)));
+        lock_guard <mutex> lock (log_lock);
+        const char * p = (const char *) &rec;
+        buf.insert (buf.end(), p, p + sizeof (struct wal_record));
+        p = (const char *) data1;
+        buf.insert (buf.end(), p, p + len1);
+        p = (const char *) data2;
+        buf.insert (buf.end(), p, p + len2);
+        next_lsn += sizeof (struct wal_record) + len1 + len2;
+        txn_changed = true;
+        if (buf.size() >= WAL_BUF_SIZE)
+        {
+            write_cond.notify_one ();
+        }
+    }
+    
+    void log_write (TableFile & tf, off_t pos, size_t len, 
+                    const void * new_data, const void * old_data)
+    {
+        if (!enabled)
+        {
+            return;
+        }
+        wal_record rec;
+        fill (rec, WAL_WRITE, tf.name, pos, len);
+        add (rec, new_data, len, old_data, len);
+    }
+    
+    void log_append (TableFile & tf, off_t pos, size_t len, 
+                     const void * new_data)
+    {
+        if (!enabled)
+        {
+            return;
+        }
+        wal_record rec;
+        fill (rec, WAL_APPEND, tf.name, pos, len);
+        add (rec, new_data, len, NULL, 0);
+    }
+    
+    void log_size (TableFile & tf, off_t old_len, off_t new_len, 
+                   const void * cut)
+    {
+        if (!enabled)
+        {
+            return;
+        }
+        wal_record rec;
+        fill (rec, WAL_SIZE, tf.name, old_len, new_len);
+        size_t cut_len = 0;
+        if (cut != NULL)
+        {
+            cut_len = old_len - new_len;
+        }
+        add (rec, cut, cut_len, NULL, 0);
+    }
+    
+    void log_create (string file_name, const void * title, size_t len)
+    {
+        if (!enabled)
+        {
+            return;
+        }
+        wal_record rec;
+        fill (rec, WAL_CREATE, file_name, 0, len);
+        add (rec, title, len, NULL, 0);
+    }
+    
+    void log_drop (string file_name)
+    {
+        if (!enabled)
+        {
+            return;
+        }
+        wal_record rec;
+        fill (rec, WAL_DROP, file_name, 0, 0);
+        add (rec, NULL, 0, NULL, 0);
+    }
+    
+    // the records collected during the fsync are written together
+    void write_loop ()
+    {
+        unique_lock <mutex> lock (log_lock);
+        while (true)
+        {
+            while (buf.empty() && !stopping)
+            {
+                write_cond.wait (lock);
+            }
+            if (buf.empty())
+            {
+                return;
+            }
+            vector <char> data;
+            data.swap (buf);
+            unsigned long lsn = next_lsn;
+            lock.unlock ();
+            bool ok = true;
+            size_t done = 0;
+            while (ok && (done < data.size()))
+            {
+                ssize_t res = write (fd, &(data[done]), data.size() - done);
+                ok = res > 0;
+                done += ok ? res : 0;
+            }
+            ok = ok && (fdatasync (fd) == 0);
+            lock.lock ();
+            if (ok)
+            {
+                durable_lsn = lsn;
+                log_len += data.size();
+                io_stats :: cur.log_syncs++;
+            }
+            else
+            {
+                failed = true;
+            }
+            durable_cond.notify_all ();
+            if (log_len >= WAL_CHECKPOINT_SIZE)
+            {
+                checkpoint_cond.notify_one ();
+            }
+        }
+    }
+    
+    void checkpoint_loop ()
+    {
+        unique_lock <mutex> lock (log_lock);
+        while (!stopping)
+        {
+            checkpoint_cond.wait_for (lock, 
+                                      chrono :: seconds (WAL_CHECKPOINT_SEC));
+            if (stopping || (log_len == 0))
+            {
+                continue;
+            }
+            lock.unlock ();
+            try
+            {
+                checkpoint ();
+            }
+            catch (TableException &)
+            {
+                // the log stays and the next checkpoint tries again
+            }
+            lock.lock ();
+        }
+    }
+} // end of namespace wal
+
+
+/*---------------btree---------------*/
+namespace btree
+{
+    void read_meta (TableFile & tf, btree_meta & meta)
+    {
+        table_files :: read_at (tf, &meta, sizeof (struct btree_meta), 0);
+        if ((memcmp (meta.magic, INDEX_MAGIC, TABLE_MAGIC_LEN) != 0) ||
+            (meta.version != INDEX_VERSION))
+        {
+            throw TableException (TableException :: ESE_VERSION);
+        }
+    }
+    
+    void write_meta (TableFile & tf, btree_meta & meta)
+    {
+        table_files :: write_at (tf, &meta, sizeof (struct btree_meta), 0);
+    }
+    
+    void read_page (TableFile & tf, unsigned long page, btree_page & pg)
+    {
+        off_t pos = (off_t) page * POOL_PAGE_SIZE;
+        table_files :: read_at (tf, &(pg.head), sizeof (struct btree_head), 
+                                pos);
+        if (pg.head.count > BTREE_ITEMS)
+        {
+            throw TableException (TableException :: ESE_FILEREAD);
+        }
+        // only the used part of the page is read
+        if (pg.head.count > 0)
+        {
+            table_files :: read_at (tf, pg.items, sizeof (struct btree_item)
+                                    * pg.head.count, 
+                                    pos + sizeof (struct btree_head));
+        }
+    }
+    
+    void write_page (TableFile & tf, unsigned long page, btree_page & pg, 
+                     unsigned long from)
+    {
+        off_t pos = (off_t) page * POOL_PAGE_SIZE;
+        if (from < pg.head.count)
+        {
+            table_files :: write_at (tf, &(pg.items[from]), 
+                                     sizeof (struct btree_item) * 
+                                     (pg.head.count - from), 
+                                     pos + sizeof (struct btree_head) + 
+                                     sizeof (struct btree_item) * from);
+        }
+        table_files :: write_at (tf, &(pg.head), sizeof (struct btree_head),
+                                 pos);
+    }
+    
+    unsigned long upper (btree_page & pg, long key, unsigned long row)
+    {
+        unsigned long lo = 0;
+        unsigned long hi = pg.head.count;
+        while (lo < hi)
+        {
+            unsigned long mid = (lo + hi) / 2;
+            if ((key < pg.items[mid].key) || 
+                ((key == pg.items[mid].key) && (row < pg.items[mid].row)))
+            {
+                hi = mid;
+            }
+            else
+            {
+                lo = mid + 1;
+            }
+        }
+        return lo;
+    }
+    
+    bool item_less (const btree_item & a, const btree_item & b)
+    {
+        return (a.key < b.key) || ((a.key == b.key) && (a.row < b.row));
+    }
+    
+    // the page of the next level where the key has to be
+    unsigned long child (btree_page & pg, long key, unsigned long row)
+    {
+        unsigned long pos = upper (pg, key, row);
+        if (pos == 0)
+        {
+            return pg.head.first;
+        }
+        return pg.items[pos - 1].child;
+    }
+    
+    // the pages are written one after another: leaves from the smallest
+    // keys, then every level of inner pages, the root is the last
+    void build (TableFile & tf, vector <btree_item> & items)
+    {
+        btree_meta meta;
+        memset (&meta, 0, sizeof (struct btree_meta));
+        memcpy (meta.magic, INDEX_MAGIC, TABLE_MAGIC_LEN);
+        meta.version = INDEX_VERSION;
+        meta.pages = 1;
+        unsigned long fill = BTREE_ITEMS * BTREE_FILL_PERCENT / 100;
+        btree_page pg;
+        // the first key and the page of every page of the level
+        vector <btree_item> level;
+        unsigned long done = 0;
+        do
+        {
+            unsigned long n = items.size() - done;
+            if (n > fill)
+            {
+                n = fill;
+            }
+            unsigned long page = meta.pages++;
+            pg.head.leaf = 1;
+            pg.head.count = n;
+            pg.head.next = (done + n < items.size()) ? page + 1 : 0;
+            pg.head.first = 0;
+            for (unsigned long i = 0; i < n; i++)
+            {
+                pg.items[i] = items[done + i];
+                pg.items[i].child = 0;
+            }
+            write_page (tf, page, pg, 0);
+            btree_item first = {0, 0, page};
+            if (n > 0)
+            {
+                first.key = items[done].key;
+                first.row = items[done].row;
+            }
+            level.push_back (first);
+            done += n;
+        }
+        while (done < items.size());
+        while (level.size() > 1)
+        {
+            vector <btree_item> next_level;
+            unsigned long i = 0;
+            while (i < level.size())
+            {
+                // children of the page
+                unsigned long n = level.size() - i;
+                if (n > fill + 1)
+                {
+                    n = fill + 1;
+                }
+                unsigned long page = meta.pages++;
+                pg.head.leaf = 0;
+                pg.head.count = n - 1;
+                pg.head.next = 0;
+                pg.head.first = level[i].child;
+                for (unsigned long j = 1; j < n; j++)
+                {
+                    pg.items[j - 1] = level[i + j];
+                }
+                write_page (tf, page, pg, 0);
+                btree_item first = level[i];
+                first.child = page;
+                next_level.push_back (first);
+                i += n;
+            }
+            level.swap (next_level);
+        }
+        meta.root = level[0].child;
+        write_meta (tf, meta);
+    }
+    
+    void insert (TableFile & tf, long key, unsigned long row)
+    {
+        btree_meta meta;
+        read_meta (tf, meta);
+        // pages from the root to the leaf
+        vector <unsigned long> path;
+        btree_page pg;
+        unsigned long page = meta.root;
+        read_page (tf, page, pg);
+        while (!pg.head.leaf)
+        {
+            path.push_back (page);
+            page = child (pg, key, row);
+            read_page (tf, page, pg);
+        }
+        btree_item item = {key, row, 0};
+        // the key goes to the upper level while the pages are split
+        while (true)
+        {
+            unsigned long pos = upper (pg, item.key, item.row);
+            if (pg.head.count < BTREE_ITEMS)
+            {
+                memmove (&(pg.items[pos + 1]), &(pg.items[pos]), 
+                         sizeof (struct btree_item) * (pg.head.count - pos));
+                pg.items[pos] = item;
+                pg.head.count++;
+                write_page (tf, page, pg, pos);
+                return;
+            }
+            vector <btree_item> all (pg.items, pg.items + pg.head.count);
+            all.insert (all.begin() + pos, item);
+            unsigned long half = all.size() / 2;
+            unsigned long new_page = meta.pages++;
+            btree_page right;
+            right.head.leaf = pg.head.leaf;
+            if (pg.head.leaf)
+            {
+                // the right half of keys goes to the new leaf
+                right.head.count = all.size() - half;
+                right.head.next = pg.head.next;
+                right.head.first = 0;
+                copy (all.begin() + half, all.end(), right.items);
+                pg.head.next = new_page;
+            }
+            else
+            {
+                // the middle key goes up, its child begins the new page
+                right.head.count = all.size() - half - 1;
+                right.head.next = 0;
+                right.head.first = all[half].child;
+                copy (all.begin() + half + 1, all.end(), right.items);
+            }
+            pg.head.count = half;
+            copy (all.begin(), all.begin() + half, pg.items);
+            write_page (tf, new_page, right, 0);
+            write_page (tf, page, pg, (pos < half) ? pos : half);
+            item = all[half];
+            item.child = new_page;
+            if (path.empty())
+            {
+                // the new root over two halves of the old one
+                btree_page root;
+                root.head.leaf = 0;
+                root.head.count = 1;
+                root.head.next = 0;
+                root.head.first = page;
+                root.items[0] = item;
+                meta.root = meta.pages++;
+                write_page (tf, meta.root, root, 0);
+                write_meta (tf, meta);
+                return;
+            }
+            write_meta (tf, meta);
+            page = path.back();
+            path.pop_back();
+            read_page (tf, page, pg);
+        }
+    }
+    
+    void erase (TableFile & tf, long key, unsigned long row)
+    {
+        btree_meta meta;
+        read_meta (tf, meta);
+        btree_page pg;
+        unsigned long page = meta.root;
+        read_page (tf, page, pg);
+        while (!pg.head.leaf)
+        {
+            page = child (pg, key, row);
+            read_page (tf, page, pg);
+        }
+        unsigned long pos = upper (pg, key, row);
+        if ((pos == 0) || (pg.items[pos - 1].key != key) || 
+            (pg.items[pos - 1].row != row))
+        {
+            return;
+        }
+        memmove (&(pg.items[pos - 1]), &(pg.items[pos]), 
+                 sizeof (struct btree_item) * (pg.head.count - pos));
+        pg.head.count--;
+        write_page (tf, page, pg, pos - 1);
+    }
+    
+    void find (TableFile & tf, long from, long to, 
+               vector <unsigned long> & rows)
+    {
+        if (from > to)
+        {
+            return;
+        }
+        btree_meta meta;
+        read_meta (tf, meta);
+        btree_page pg;
+        unsigned long page = meta.root;
+        read_page (tf, page, pg);
+        // numbers of records begin from 1, so the key (from, 0) 
+        // is less than all keys with the value from
+        while (!pg.head.leaf)
+        {
+            page = child (pg, from, 0);
+            read_page (tf, page, pg);
+        }
+        unsigned long pos = upper (pg, from, 0);
+        // the keys are taken from the leaves one after another
+        while (true)
+        {
+            for (; pos < pg.head.count; pos++)
+            {
+                if (pg.items[pos].key > to)
+                {
+                    return;
+                }
+                rows.push_back (pg.items[pos].row);
+            }
+            if (pg.head.next == 0)
+            {
+                return;
+            }
+            read_page (tf, pg.head.next, pg);
+            pos = 0;
+        }
+    }
+} // end of namespace btree
+
+
+/*---------------hash_index---------------*/
+namespace hash_index
+{
+    void read_meta (TableFile & tf, hash_meta & meta)
+    {
+        table_files :: read_at (tf, &meta, sizeof (struct hash_meta), 0);
+        if ((memcmp (meta.magic, INDEX_MAGIC, TABLE_MAGIC_LEN) != 0) ||
+            (meta.version != INDEX_VERSION))
+        {
+            throw TableException (TableException :: ESE_VERSION);
+        }
+    }
+    
+    void write_meta (TableFile & tf, hash_meta & meta)
+    {
+        table_files :: write_at (tf, &meta, sizeof (struct hash_meta), 0);
+    }
+    
+    void read_page (TableFile & tf, unsigned long page, hash_page & pg)
+    {
+        off_t pos = (off_t) page * POOL_PAGE_SIZE;
+        table_files :: read_at (tf, &(pg.head), sizeof (struct hash_head), 
+                                pos);
+        if (pg.head.count > HASH_ITEMS)
+        {
+            throw TableException (TableException :: ESE_FILEREAD);
+        }
+        if (pg.head.count > 0)
+        {
+            table_files :: read_at (tf, pg.items, sizeof (struct hash_item)
+                                    * pg.head.count, 
+                                    pos + sizeof (struct hash_head));
+        }
+    }
+    
+    void write_page (TableFile & tf, unsigned long page, hash_page & pg, 
+                     unsigned long from)
+    {
+        off_t pos = (off_t) page * POOL_PAGE_SIZE;
+        if (from < pg.head.count)
+        {
+            table_files :: write_at (tf, &(pg.items[from]), 
+                                     sizeof (struct hash_item) * 
+                                     (pg.head.count - from), 
+                                     pos + sizeof (struct hash_head) + 
+                                     sizeof (struct hash_item) * from);
+        }
+        table_files :: write_at (tf, &(pg.head), sizeof (struct hash_head),
+                                 pos);
+    }
+    
+    void make_item (hash_item & item, string key, unsigned long row)
+    {
+        memset (&item, 0, sizeof (struct hash_item));
+        item.row = row;
+        memcpy (item.key, key.c_str(), min (key.length(), 
+                                            (size_t) MAX_TEXT_LEN));
+    }
+    
+    bool same_key (hash_item & item, string key)
+    {
+        return key == string (item.key, strnlen (item.key, MAX_TEXT_LEN));
+    }
+    
+    unsigned long bucket (string key, unsigned long buckets)
+    {
+        return wal :: sum (key.c_str(), key.length(), 0) % buckets;
+    }
+    
+    unsigned long buckets_for (unsigned long count)
+    {
+        unsigned long buckets = HASH_START_BUCKETS;
+        while (count * 100 > buckets * HASH_ITEMS * HASH_LOAD_PERCENT)
+        {
+            buckets *= 2;
+        }
+        return buckets;
+    }
+    
+    // the first pages of all buckets are written, then the pages
+    // for the rest of long chains
+    void build (TableFile & tf, vector <hash_item> & items, 
+                unsigned long buckets)
+    {
+        hash_meta meta;
+        memset (&meta, 0, sizeof (struct hash_meta));
+        memcpy (meta.magic, INDEX_MAGIC, TABLE_MAGIC_LEN);
+        meta.version = INDEX_VERSION;
+        meta.buckets = buckets;
+        meta.pages = buckets + 1;
+        meta.count = items.size();
+        vector <vector <hash_item> > parts (buckets);
+        for (unsigned long i = 0; i < items.size(); i++)
+        {
+            parts[bucket (string (items[i].key, strnlen (items[i].key, 
+                                                         MAX_TEXT_LEN)),
+                          buckets)].push_back (items[i]);
+        }
+        hash_page pg;
+        for (unsigned long b = 0; b < buckets; b++)
+        {
+            unsigned long page = b + 1;
+            unsigned long done = 0;
+            do
+            {
+                unsigned long n = parts[b].size() - done;
+                pg.head.next = 0;
+                if (n > HASH_ITEMS)
+                {
+                    n = HASH_ITEMS;
+                    pg.head.next = meta.pages++;
+                }
+                pg.head.count = n;
+                copy (parts[b].begin() + done, parts[b].begin() + done + n,
+                      pg.items);
+                write_page (tf, page, pg, 0);
+                page = pg.head.next;
+                done += n;
+            }
+            while (done < parts[b].size());
+        }
+        write_meta (tf, meta);
+    }
+    
+    void grow (TableFile & tf)
+    {
+        hash_meta meta;
+        read_meta (tf, meta);
+        vector <hash_item> items;
+        hash_page pg;
+        for (unsigned long page = 1; page < meta.pages; page++)
+        {
+            read_page (tf, page, pg);
+            items.insert (items.end(), pg.items, pg.items + pg.head.count);
+        }
+        // the old pages are kept in the log for the rollback
+        table_files :: resize (tf, 0);
+        build (tf, items, meta.buckets * 2);
+    }
+    
+    void insert (TableFile & tf, string key, unsigned long row)
+    {
+        hash_meta meta;
+        read_meta (tf, meta);
+        hash_page pg;
+        unsigned long page = bucket (key, meta.buckets) + 1;
+        read_page (tf, page, pg);
+        // the first page of the chain with free place
+        while ((pg.head.count == HASH_ITEMS) && (pg.head.next != 0))
+        {
+            page = pg.head.next;
+            read_page (tf, page, pg);
+        }
+        if (pg.head.count == HASH_ITEMS)
+        {
+            // the new page at the end of the chain
+            pg.head.next = meta.pages++;
+            write_page (tf, page, pg, pg.head.count);
+            page = pg.head.next;
+            pg.head.count = 0;
+            pg.head.next = 0;
+        }
+        make_item (pg.items[pg.head.count], key, row);
+        pg.head.count++;
+        write_page (tf, page, pg, pg.head.count - 1);
+        meta.count++;
+        write_meta (tf, meta);
+        if (meta.count * 100 > meta.buckets * HASH_ITEMS * HASH_LOAD_PERCENT)
+        {
+            grow (tf);
+        }
+    }
+    
+    void erase (TableFile & tf, string key, unsigned long row)
+    {
+        hash_meta meta;
+        read_meta (tf, meta);
+        hash_page pg;
+        unsigned long page = bucket (key, meta.buckets) + 1;
+        while (page != 0)
+        {
+            read_page (tf, page, pg);
+            for (unsigned long i = 0; i < pg.head.count; i++)
+            {
+                if ((pg.items[i].row == row) && same_key (pg.items[i], key))
+                {
+                    // the last key of the page takes the place
+                    pg.head.count--;
+                    pg.items[i] = pg.items[pg.head.count];
+                    write_page (tf, page, pg, i);
+                    meta.count--;
+                    write_meta (tf, meta);
+                    return;
+                }
+            }
+            page = pg.head.next;
+        }
+    }
+    
+    void find (TableFile & tf, string key, vector <unsigned long> & rows)
+    {
+        // such text can't be in the field
+        if (key.length() > MAX_TEXT_LEN)
+        {
+            return;
+        }
+        hash_meta meta;
+        read_meta (tf, meta);
+        hash_page pg;
+        unsigned long page = bucket (key, meta.buckets) + 1;
+        while (page != 0)
+        {
+            read_page (tf, page, pg);
+            for (unsigned long i = 0; i < pg.head.count; i++)
+            {
+                if (same_key (pg.items[i], key))
+                {
+                    rows.push_back (pg.items[i].row);
+                }
+            }
+            page = pg.head.next;
+        }
+    }
+} // end of namespace hash_index
+
+
+/*---------------trigram_index---------------*/
+namespace trigram_index
+{
+    void codes (string text, vector <long> & keys)
+    {
+        keys.clear();
+        for (size_t i = 0; i + 3 <= text.length(); i++)
+        {
+            keys.push_back (((long) (unsigned char) text[i] << 16) | 
+                            ((long) (unsigned char) text[i + 1] << 8) |
+                            (long) (unsigned char) text[i + 2]);
+        }
+        sort (keys.begin(), keys.end());
+        keys.erase (unique (keys.begin(), keys.end()), keys.end());
+    }
+    
+    void insert (TableFile & tf, string text, unsigned long row)
+    {
+        vector <long> keys;
+        codes (text, keys);
+        for (unsigned long i = 0; i < keys.size(); i++)
+        {
+            btree :: insert (tf, keys[i], row);
+        }
+    }
+    
+    void erase (TableFile & tf, string text, unsigned long row)
+    {
+        vector <long> keys;
+        codes (text, keys);
+        for (unsigned long i = 0; i < keys.size(); i++)
+        {
+            btree :: erase (tf, keys[i], row);
+        }
+    }
+    
+    void find (TableFile & tf, const vector <string> & parts, 
+               vector <unsigned long> & rows)
+    {
+        vector <long> keys;
+        vector <long> part_keys;
+        for (unsigned long i = 0; i < parts.size(); i++)
+        {
+            codes (parts[i], part_keys);
+            keys.insert (keys.end(), part_keys.begin(), part_keys.end());
+        }
+        sort (keys.begin(), keys.end());
+        keys.erase (unique (keys.begin(), keys.end()), keys.end());
+        // lists of records of the trigrams are intersected
+        vector <unsigned long> found;
+        vector <unsigned long> list;
+        for (unsigned long i = 0; i < keys.size(); i++)
+        {
+            list.clear();
+            btree :: find (tf, keys[i], keys[i], list);
+            if (i == 0)
+            {
+                found.swap (list);
+            }
+            else
+            {
+                vector <unsigned long> both;
+                set_intersection (found.begin(), found.end(), list.begin(),
+                                  list.end(), back_inserter (both));
+                found.swap (both);
+            }
+            if (found.empty())
+            {
+                break;
+            }
+        }
+        rows.insert (rows.end(), found.begin(), found.end());
+    }
+} // end of namespace trigram_index
+
+
+/*---------------bloom---------------*/
+namespace bloom
+{
+    void make_meta (bloom_meta & meta, unsigned long bits)
+    {
+        memset (&meta, 0, sizeof (struct bloom_meta));
+        memcpy (meta.magic, INDEX_MAGIC, TABLE_MAGIC_LEN);
+        meta.version = INDEX_VERSION;
+        meta.bits = bits;
+        // the best number is bits for one text multiplied by ln 2
+        meta.hashes = bits * 69 / (ZONE_LINES * 100);
+        meta.hashes = max (1UL, min ((unsigned long) BLOOM_MAX_HASHES, 
+                                     meta.hashes));
+    }
+    
+    void read_meta (TableFile & tf, bloom_meta & meta)
+    {
+        table_files :: read_at (tf, &meta, sizeof (struct bloom_meta), 0);
+        if ((memcmp (meta.magic, INDEX_MAGIC, TABLE_MAGIC_LEN) != 0) ||
+            (meta.version != INDEX_VERSION) || (meta.bits == 0) || 
+            (meta.bits % 8 != 0))
+        {
+            throw TableException (TableException :: ESE_VERSION);
+        }
+    }
+    
+    void write_meta (TableFile & tf, bloom_meta & meta)
+    {
+        table_files :: write_at (tf, &meta, sizeof (struct bloom_meta), 0);
+    }
+    
+    // double hashing: two sums give all positions
+    void positions (string text, bloom_meta & meta, 
+                    vector <unsigned long> & bits)
+    {
+        unsigned long h1 = wal :: sum (text.c_str(), text.length(), 0);
+        unsigned long h2 = wal :: sum (text.c_str(), text.length(), h1) | 1;
+        bits.clear();
+        for (unsigned long i = 0; i < meta.hashes; i++)
+        {
+            bits.push_back ((h1 + i * h2) % meta.bits);
+        }
+    }
+    
+    off_t filter_pos (bloom_meta & meta, unsigned long zone)
+    {
+        return sizeof (struct bloom_meta) + (off_t) zone * (meta.bits / 8);
+    }
+    
+    void build (TableFile & tf, bloom_meta & meta, vector <hash_item> & keys)
+    {
+        unsigned long zones = 0;
+        for (unsigned long i = 0; i < keys.size(); i++)
+        {
+            zones = max (zones, (keys[i].row - 1) / ZONE_LINES + 1);
+        }
+        vector <unsigned char> filters (zones * (meta.bits / 8), 0);
+        vector <unsigned long> bits;
+        for (unsigned long i = 0; i < keys.size(); i++)
+        {
+            positions (string (keys[i].key, strnlen (keys[i].key, 
+                                                     MAX_TEXT_LEN)), 
+                       meta, bits);
+            unsigned char * f = &(filters[0]) + 
+                                (keys[i].row - 1) / ZONE_LINES * 
+                                (meta.bits / 8);
+            for (unsigned long j = 0; j < bits.size(); j++)
+            {
+                f[bits[j] / 8] |= 1 << (bits[j] % 8);
+            }
+        }
+        write_meta (tf, meta);
+        if (!filters.empty())
+        {
+            table_files :: write_at (tf, &(filters[0]), filters.size(), 
+                                     filter_pos (meta, 0));
+        }
+    }
+    
+    // only the bytes with new bits are written
+    void insert (TableFile & tf, string text, unsigned long row)
+    {
+        bloom_meta meta;
+        read_meta (tf, meta);
+        off_t pos = filter_pos (meta, (row - 1) / ZONE_LINES);
+        vector <unsigned long> bits;
+        positions (text, meta, bits);
+        for (unsigned long j = 0; j < bits.size(); j++)
+        {
+            unsigned char byte = 0;
+            // the filter of the new zone is not in the file yet
+            if (pos + (off_t) (bits[j] / 8) < tf.file_len)
+            {
+                table_files :: read_at (tf, &byte, 1, pos + bits[j] / 8);
+            }
+            if (!(byte & (1 << (bits[j] % 8))))
+            {
+                byte |= 1 << (bits[j] % 8);
+                table_files :: write_at (tf, &byte, 1, pos + bits[j] / 8);
+            }
+        }
+    }
+    
+    void find (TableFile & tf, const vector <string> & texts, 
+               vector <bool> & absent)
+    {
+        bloom_meta meta;
+        read_meta (tf, meta);
+        vector <vector <unsigned long> > bits (texts.size());
+        for (unsigned long i = 0; i < texts.size(); i++)
+        {
+            positions (texts[i], meta, bits[i]);
+        }
+        unsigned long zones = (tf.file_len - filter_pos (meta, 0)) / 
+                              (meta.bits / 8);
+        // filters are read like blocks of the scanner, past the pool
+        buffer_pool :: flush (tf);
+        vector <unsigned char> filters (zones * (meta.bits / 8));
+        if (!filters.empty())
+        {
+            table_files :: read_direct (tf, &(filters[0]), filters.size(), 
+                                        filter_pos (meta, 0));
+        }
+        absent.assign (zones, true);
+        for (unsigned long z = 0; z < zones; z++)
+        {
+            unsigned char * f = &(filters[0]) + z * (meta.bits / 8);
+            for (unsigned long i = 0; absent[z] && (i < texts.size()); i++)
+            {
+                bool all = true;
+                for (unsigned long j = 0; all && (j < bits[i].size()); j++)
+                {
+                    all = f[bits[i][j] / 8] & (1 << (bits[i][j] % 8));
+                }
+                absent[z] = !all;
+            }
+        }
+    }
+} // end of namespace bloom
+
+
+/*---------------codec---------------*/
+namespace codec
+{
+    unsigned long bits_for (unsigned long num)
+    {
+        unsigned long bits = 0;
+        while (num != 0)
+        {
+            bits++;
+            num >>= 1;
+        }
+        return bits;
+    }
+    
+    // pos is the number of the bit from the beginning of out
+    void put_bits (vector <char> & out, unsigned long & pos, 
+                   unsigned long num, unsigned long width)
+    {
+        unsigned long b = 0;
+        while (b < width)
+        {
+            unsigned long shift = pos % 8;
+            unsigned long take = min (8 - shift, width - b);
+            out[pos / 8] |= (char) (((num >> b) & ((1UL << take) - 1)) 
+                                    << shift);
+            pos += take;
+            b += take;
+        }
+    }
+    
+    unsigned long get_bits (const char * data, unsigned long & pos, 
+                            unsigned long width)
+    {
+        unsigned long num = 0;
+        unsigned long b = 0;
+        while (b < width)
+        {
+            unsigned long shift = pos % 8;
+            unsigned long take = min (8 - shift, width - b);
+            num |= ((((unsigned char) data[pos / 8]) >> shift) & 
+                    ((1UL << take) - 1)) << b;
+            pos += take;
+            b += take;
+        }
+        return num;
+    }
+    
+    // the head: the kind (0 - from the least value, 1 - deltas), 
+    // bits of one value, the least value or delta, 
+    // for deltas the first value
+    void pack_longs (const char * data, unsigned long count, 
+                     vector <char> & out)
+    {
+        vector <long> nums (count);
+        if (count != 0)
+        {
+            memcpy (&(nums[0]), data, count * sizeof (long));
+        }
+        long least = 0;
+        if (count != 0)
+        {
+            least = *(min_element (nums.begin(), nums.end()));
+        }
+        unsigned long width = 0;
+        for (unsigned long i = 0; i < count; i++)
+        {
+            width = max (width, bits_for ((unsigned long) nums[i] - 
+                                          (unsigned long) least));
+        }
+        // deltas are used if they are not greater than long
+        vector <long> deltas;
+        bool sorted = (count > 1);
+        for (unsigned long i = 1; sorted && (i < count); i++)
+        {
+            long a = nums[i];
+            long b = nums[i - 1];
+            if (((b < 0) && (a > LONG_MAX + b)) || 
+                ((b > 0) && (a < LONG_MIN + b)))
+            {
+                sorted = false;
+            }
+            else
+            {
+                deltas.push_back (a - b);
+            }
+        }
+        long least_delta = 0;
+        unsigned long delta_width = 0;
+        if (sorted)
+        {
+            least_delta = *(min_element (deltas.begin(), deltas.end()));
+            for (unsigned long i = 0; i < deltas.size(); i++)
+            {
+                delta_width = max (delta_width, 
+                                   bits_for ((unsigned long) deltas[i] - 
+                                             (unsigned long) least_delta));
+            }
+        }
+        char kind = sorted && (delta_width < width);
+        const vector <long> & packed = kind ? deltas : nums;
+        long base = kind ? least_delta : least;
+        width = kind ? delta_width : width;
+        size_t head = 2 + sizeof (long) + (kind ? sizeof (long) : 0);
+        out.assign (head + (packed.size() * width + 7) / 8, 0);
+        out[0] = kind;
+        out[1] = (char) width;
+        memcpy (&(out[2]), &base, sizeof (long));
+        if (kind)
+        {
+            memcpy (&(out[2 + sizeof (long)]), &(nums[0]), sizeof (long));
+        }
+        unsigned long pos = head * 8;
+        for (unsigned long i = 0; i < packed.size(); i++)
+        {
+            put_bits (out, pos, (unsigned long) packed[i] - 
+                                (unsigned long) base, width);
+        }
+    }
+    
+    void unpack_longs (const char * data, size_t len, unsigned long count, 
+                       char * out)
+    {
+        if (len < 2 + sizeof (long))
+        {
+            throw TableException (TableException :: ESE_FILEREAD);
+        }
+        char kind = data[0];
+        unsigned long width = (unsigned char) data[1];
+        long base;
+        memcpy (&base, data + 2, sizeof (long));
+        size_t head = 2 + sizeof (long) + (kind ? sizeof (long) : 0);
+        unsigned long packed = (kind && (count > 0)) ? count - 1 : count;
+        if ((width > 64) || (len < head + (packed * width + 7) / 8))
+        {
+            throw TableException (TableException :: ESE_FILEREAD);
+        }
+        unsigned long pos = head * 8;
+        unsigned long num = 0;
+        for (unsigned long i = 0; i < count; i++)
+        {
+            if (!kind)
+            {
+                num = (unsigned long) base + get_bits (data, pos, width);
+            }
+            else if (i == 0)
+            {
+                memcpy (&num, data + 2 + sizeof (long), sizeof (long));
+            }
+            else
+            {
+                num += (unsigned long) base + get_bits (data, pos, width);
+            }
+            memcpy (out + i * sizeof (long), &num, sizeof (long));
+        }
+    }
+    
+    void put_length (vector <char> & out, unsigned long len)
+    {
+        while (len >= 255)
+        {
+            out.push_back ((char) 255);
+            len -= 255;
+        }
+        out.push_back ((char) len);
+    }
+    
+    unsigned long get_length (const char * data, size_t len, size_t & pos)
+    {
+        unsigned long sum = 0;
+        unsigned char byte;
+        do
+        {
+            if (pos >= len)
+            {
+                throw TableException (TableException :: ESE_FILEREAD);
+            }
+            byte = data[pos++];
+            sum += byte;
+        }
+        while (byte == 255);
+        return sum;
+    }
+    
+    // every part is the byte with numbers of literals and of copied
+    // bytes (by 4 bits, 15 - the rest follows), the literals and 
+    // the distance back to the copied bytes, the last part has no copy
+    void lz_compress (const char * data, size_t len, vector <char> & out)
+    {
+        out.clear();
+        vector <long> last (1UL << LZ_HASH_BITS, -1);
+        size_t from = 0; // the first byte of literals
+        size_t i = 0;
+        while (i + LZ_MIN_MATCH <= len)
+        {
+            unsigned int word;
+            memcpy (&word, data + i, sizeof (word));
+            unsigned long h = (word * 2654435761U) >> (32 - LZ_HASH_BITS);
+            long prev = last[h];
+            last[h] = i;
+            if ((prev < 0) || (i - prev > LZ_WINDOW) || 
+                (memcmp (data + prev, data + i, LZ_MIN_MATCH) != 0))
+            {
+                i++;
+                continue;
+            }
+            size_t copy = LZ_MIN_MATCH;
+            while ((i + copy < len) && (data[prev + copy] == data[i + copy]))
+            {
+                copy++;
+            }
+            unsigned long lit = i - from;
+            unsigned long rest = copy - LZ_MIN_MATCH;
+            out.push_back ((char) ((min (lit, 15UL) << 4) | 
+                                   min (rest, 15UL)));
+            if (lit >= 15)
+            {
+                put_length (out, lit - 15);
+            }
+            out.insert (out.end(), data + from, data + i);
+            out.push_back ((char) ((i - prev) & 255));
+            out.push_back ((char) ((i - prev) >> 8));
+            if (rest >= 15)
+            {
+                put_length (out, rest - 15);
+            }
+            i += copy;
+            from = i;
+        }
+        unsigned long lit = len - from;
+        out.push_back ((char) (min (lit, 15UL) << 4));
+        if (lit >= 15)
+        {
+            put_length (out, lit - 15);
+        }
+        out.insert (out.end(), data + from, data + len);
+    }
+    
+    void lz_decompress (const char * data, size_t len, char * out, 
+                        size_t out_len)
+    {
+        size_t pos = 0;
+        size_t done = 0;
+        while (pos < len)
+        {
+            unsigned char head = data[pos++];
+            unsigned long lit = head >> 4;
+            if (lit == 15)
+            {
+                lit += get_length (data, len, pos);
+            }
+            if ((lit > len - pos) || (lit > out_len - done))
+            {
+                throw TableException (TableException :: ESE_FILEREAD);
+            }
+            memcpy (out + done, data + pos, lit);
+            pos += lit;
+            done += lit;
+            // the last part
+            if (pos == len)
+            {
+                break;
+            }
+            if (len - pos < 2)
+            {
+                throw TableException (TableException :: ESE_FILEREAD);
+            }
+            unsigned long back = (unsigned char) data[pos] | 
+                                 ((unsigned long) (unsigned char) 
+                                  data[pos + 1] << 8);
+            pos += 2;
+            unsigned long copy = head & 15;
+            if (copy == 15)
+            {
+                copy += get_length (data, len, pos);
+            }
+            copy += LZ_MIN_MATCH;
+            if ((back == 0) || (back > done) || (copy > out_len - done))
+            {
+                throw TableException (TableException :: ESE_FILEREAD);
+            }
+            // the copy can overlap the bytes it makes
+            for (unsigned long k = 0; k < copy; k++)
+            {
+                out[done + k] = out[done - back + k];
+            }
+            done += copy;
+        }
+        if (done != out_len)
+        {
+            throw TableException (TableException :: ESE_FILEREAD);
+        }
+    }
+} // end of namespace codec
+
+
+/*---------------stats---------------*/
+namespace stats
+{
+    // FNV-1a with mixing of all bits, the least hashes have to be uniform
+    unsigned long hash (const void * data, size_t len)
+    {
+        unsigned long h = wal :: sum (data, len, 0);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdUL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53UL;
+        h ^= h >> 33;
+        return h;
+    }
+    
+    string text (const char * data)
+    {
+        return string (data, strnlen (data, MAX_TEXT_LEN));
+    }
+    
+    void least_hashes (const set <unsigned long> & all, zone_stats & z)
+    {
+        z.num_hashes = 0;
+        set <unsigned long> :: const_iterator it = all.begin();
+        for (; (it != all.end()) && (z.num_hashes < STAT_HASHES); it++)
+        {
+            z.hashes[z.num_hashes++] = *it;
+        }
+    }
+    
+    void zone_longs (vector <long> & values, zone_stats & z)
+    {
+        memset (&z, 0, sizeof (struct zone_stats));
+        z.rows = values.size();
+        z.non_null = values.size();
+        if (values.empty())
+        {
+            return;
+        }
+        sort (values.begin(), values.end());
+        z.min = values.front();
+        z.max = values.back();
+        set <unsigned long> all;
+        for (unsigned long k = 0; k < values.size(); k++)
+        {
+            all.insert (hash (&(values[k]), sizeof (long)));
+        }
+        least_hashes (all, z);
+        z.num_samples = min ((unsigned long) STAT_SAMPLES, z.rows);
+        for (unsigned long k = 0; k < z.num_samples; k++)
+        {
+            z.samples[k] = values[(2 * k + 1) * z.rows / 
+                                  (2 * z.num_samples)];
+        }
+    }
+    
+    void zone_texts (const vector <string> & values, zone_stats & z)
+    {
+        memset (&z, 0, sizeof (struct zone_stats));
+        z.rows = values.size();
+        if (values.empty())
+        {
+            return;
+        }
+        string least = values[0];
+        string greatest = values[0];
+        set <unsigned long> all;
+        map <string, unsigned long> counts;
+        for (unsigned long k = 0; k < values.size(); k++)
+        {
+            if (!values[k].empty())
+            {
+                z.non_null++;
+            }
+            least = min (least, values[k]);
+            greatest = max (greatest, values[k]);
+            all.insert (hash (values[k].data(), values[k].size()));
+            counts[values[k]]++;
+        }
+        memcpy (z.min_text, least.data(), 
+                min (least.size(), (size_t) MAX_TEXT_LEN));
+        memcpy (z.max_text, greatest.data(), 
+                min (greatest.size(), (size_t) MAX_TEXT_LEN));
+        least_hashes (all, z);
+        // the greatest counts first
+        vector <pair <unsigned long, string> > order;
+        map <string, unsigned long> :: iterator it;
+        for (it = counts.begin(); it != counts.end(); it++)
+        {
+            order.push_back (make_pair (ULONG_MAX - it -> second, 
+                                        it -> first));
+        }
+        sort (order.begin(), order.end());
+        z.num_common = min ((unsigned long) STAT_COMMON, order.size());
+        for (unsigned long k = 0; k < z.num_common; k++)
+        {
+            strncpy (z.common[k].text, order[k].second.c_str(), 
+                     MAX_TEXT_LEN);
+            z.common[k].count = ULONG_MAX - order[k].first;
+        }
+    }
+    
+    // zones of the field i of nf fields, counts of common values are
+    // summed only where they are among the most common in the zone
+    void merge (const vector <zone_stats> & zones, unsigned long i, 
+                unsigned long nf, bool is_long, column_stats & out)
+    {
+        memset (&out, 0, sizeof (struct column_stats));
+        set <unsigned long> all;
+        vector <pair <long, double> > samples;
+        map <string, unsigned long> counts;
+        string least;
+        string greatest;
+        for (unsigned long j = i; j < zones.size(); j += nf)
+        {
+            const zone_stats & z = zones[j];
+            if (z.rows == 0)
+            {
+                continue;
+            }
+            string z_least = text (z.min_text);
+            string z_greatest = text (z.max_text);
+            if (out.rows == 0)
+            {
+                out.min = z.min;
+                out.max = z.max;
+                least = z_least;
+                greatest = z_greatest;
+            }
+            out.rows += z.rows;
+            out.non_null += z.non_null;
+            out.min = min (out.min, z.min);
+            out.max = max (out.max, z.max);
+            least = min (least, z_least);
+            greatest = max (greatest, z_greatest);
+            all.insert (z.hashes, z.hashes + z.num_hashes);
+            for (unsigned long k = 0; k < z.num_samples; k++)
+            {
+                samples.push_back (make_pair (z.samples[k], 
+                                              (double) z.rows / 
+                                              z.num_samples));
+            }
+            for (unsigned long k = 0; k < z.num_common; k++)
+            {
+                counts[text (z.common[k].text)] += z.common[k].count;
+            }
+        }
+        if (out.rows == 0)
+        {
+            return;
+        }
+        // the hashes are uniform, so the k-th least of them is about 
+        // k / distinct of all hashes
+        if (all.size() < STAT_HASHES)
+        {
+            out.distinct = all.size();
+        }
+        else
+        {
+            set <unsigned long> :: iterator it = all.begin();
+            advance (it, STAT_HASHES - 1);
+            double part = (double) *it / (double) ULONG_MAX;
+            out.distinct = min ((double) out.rows, 
+                                (STAT_HASHES - 1) / part);
+        }
+        if (is_long)
+        {
+            // bounds of buckets with equal numbers of records
+            sort (samples.begin(), samples.end());
+            out.num_bounds = STAT_BUCKETS + 1;
+            out.bounds[0] = out.min;
+            out.bounds[STAT_BUCKETS] = out.max;
+            double sum = 0;
+            unsigned long k = 0;
+            for (unsigned long b = 1; b < STAT_BUCKETS; b++)
+            {
+                double depth = (double) out.rows * b / STAT_BUCKETS;
+                while ((k + 1 < samples.size()) && 
+                       (sum + samples[k].second < depth))
+                {
+                    sum += samples[k].second;
+                    k++;
+                }
+                out.bounds[b] = samples[k].first;
+            }
+            return;
+        }
+        memcpy (out.min_text, least.data(), 
+                min (least.size(), (size_t) MAX_TEXT_LEN));
+        memcpy (out.max_text, greatest.data(), 
+                min (greatest.size(), (size_t) MAX_TEXT_LEN));
+        vector <pair <unsigned long, string> > order;
+        map <string, unsigned long> :: iterator it;
+        for (it = counts.begin(); it != counts.end(); it++)
+        {
+            order.push_back (make_pair (ULONG_MAX - it -> second, 
+                                        it -> first));
+        }
+        sort (order.begin(), order.end());
+        out.num_common = min ((unsigned long) STAT_COMMON, order.size());
+        for (unsigned long k = 0; k < out.num_common; k++)
+        {
+            strncpy (out.common[k].text, order[k].second.c_str(), 
+                     MAX_TEXT_LEN);
+            out.common[k].count = ULONG_MAX - order[k].first;
+        }
+    }
+} // end of namespace stats
+
+
+/*---------------Table---------------*/
+void Table :: create_table (string t_name)
+{
+    if (t_name.length() > MAX_TABLE_NAME_LEN)
+    {
+        throw TableException (TableException :: ESE_FILENAME);
+    }
+    strcpy (t_struct.table_name, t_name.c_str());
+    for (unsigned long i = 0; i < t_struct.num_of_fields; i++)
+    {
+        strcpy (fields[i].text, "");
+        // TEXT fields keep the width of the code
+        if (fields[i].type == LONG)
+        {
+            fields[i].l_num = 0;
+        }
+    }
+    // the file stays opened in the cache after creating
+    table_files :: create (t_name, t_struct, fields);
+    catalog :: add (t_struct, fields);
+}
+
+void Table :: open_table (string t_name)
+{
+    // the title is read from the file only once,
+    // the fields are taken from the catalog
+    TableFile & tf = table_files :: open (t_name);
+    t_struct = tf.t_struct;
+    fields = tf.fields;
+}
+
+void Table :: delete_table (string t_name)
+{
+    // cleaning any info about the table
+    t_struct.num_of_fields = 0;
+    t_struct.num_of_records = 0;
+    t_struct.title_length = sizeof (struct table_struct);
+    fields.clear();
+    table_files :: close (t_name);
+    table_files :: drop_side_files (t_name);
+    string file_name = t_name + ".txt";
+    if (!table_files :: exists (file_name))
+    {
+        throw TableException (TableException :: ESE_FILEREMOVE);
+    }
+    // deleting the file with data
+    table_files :: remove_file (file_name);
+    catalog :: remove (t_name);
+}
+
+TableFile & Table :: get_file ()
+{
+    return table_files :: open (string (t_struct.table_name));
+}
+
+void Table :: use_fields (const vector <string> & names)
+{
+    used_fields.assign (t_struct.num_of_fields, false);
+    for (unsigned long i = 0; i < names.size(); i++)
+    {
+        for (unsigned long j = 0; j < t_struct.num_of_fields; j++)
+        {
+            if (names[i] == fields[j].name)
+            {
+                used_fields[j] = true;
+            }
+        }
+    }
+}
+
+void Table :: use_all_fields ()
+{
+    used_fields.clear();
+}
+
+void Table :: set_access (access_type acc)
+{
+    table_files :: advise (get_file (), acc);
+}
+
+const char * Table :: value_ptr (const unsigned long line_num, 
+                                 unsigned long i)
+{
+    if ((line_num > t_struct.num_of_records) || 
+        (line_num <= 0))
+    {
+        throw TableException (TableException :: ESE_LINENUM);
+    }
+    TableFile & tf = get_file ();
+    if (tf.t_struct.storage == COMPRESSED_STORAGE)
+    {
+        return zone_value (tf, line_num - 1, i);
+    }
+    // the value is addressed in the page of the buffer pool
+    return table_files :: view (tf, field_pos (tf, line_num - 1, i), 
+                                tf.widths[i], &(tf.line[tf.offsets[i]]));
+}
+
+long Table :: get_long (const unsigned long line_num, unsigned long i)
+{
+    long num;
+    memcpy (&num, value_ptr (line_num, i), sizeof (long));
+    return num;
+}
+
+string Table :: get_text (const unsigned long line_num, unsigned long i)
+{
+    return text_value (get_file (), i, value_ptr (line_num, i));
+}
+
+// position of the i-th field of the record with number line (from 0)
+off_t Table :: field_pos (TableFile & tf, unsigned long line, 
+                          unsigned long i)
+{
+    if (tf.t_struct.storage == COLUMN_STORAGE)
+    {
+        return tf.t_struct.title_length + 
+               tf.t_struct.capacity * tf.offsets[i] + 
+               line * tf.widths[i];
+    }
+    return tf.t_struct.title_length + tf.t_struct.row_length * line + 
+           tf.offsets[i];
+}
+
+// position of the flag of the record with number line (from 0)
+off_t Table :: flag_pos (TableFile & tf, unsigned long line)
+{
+    if (tf.t_struct.storage == COLUMN_STORAGE)
+    {
+        return tf.t_struct.title_length + line;
+    }
+    return tf.t_struct.title_length + tf.t_struct.row_length * line;
+}
+
+// reading the record to the buffer of the file
+void Table :: read_record (TableFile & tf, unsigned long line)
+{
+    if (tf.t_struct.storage == ROW_STORAGE)
+    {
+        // the line is read by one call from its computed position
+        table_files :: read_at (tf, &(tf.line[0]), tf.t_struct.row_length, 
+                                flag_pos (tf, line));
+        return;
+    }
+    if (tf.t_struct.storage == COMPRESSED_STORAGE)
+    {
+        tf.line[0] = ROW_LIVE;
+        for (unsigned long i = 0; i < tf.t_struct.num_of_fields; i++)
+        {
+            if (used_fields.empty() || used_fields[i])
+            {
+                memcpy (&(tf.line[tf.offsets[i]]), zone_value (tf, line, i),
+                        tf.widths[i]);
+            }
+        }
+        return;
+    }
+    // only the flag and necessary segments are read
+    table_files :: read_at (tf, &(tf.line[0]), ROW_FLAG_LEN, 
+                            flag_pos (tf, line));
+    for (unsigned long i = 0; i < tf.t_struct.num_of_fields; i++)
+    {
+        if (used_fields.empty() || used_fields[i])
+        {
+            table_files :: read_at (tf, &(tf.line[tf.offsets[i]]), 
+                                    tf.widths[i], field_pos (tf, line, i));
+        }
+    }
+}
+
+// writing the buffer of the file to the record
+void Table :: write_record (TableFile & tf, unsigned long line)
+{
+    if (tf.t_struct.storage == ROW_STORAGE)
+    {
+        table_files :: write_at (tf, &(tf.line[0]), tf.t_struct.row_length,
+                                 flag_pos (tf, line));
+        return;
+    }
+    table_files :: write_at (tf, &(tf.line[0]), ROW_FLAG_LEN, 
+                             flag_pos (tf, line));
+    for (unsigned long i = 0; i < tf.t_struct.num_of_fields; i++)
+    {
+        table_files :: write_at (tf, &(tf.line[tf.offsets[i]]), 
+                                 tf.widths[i], field_pos (tf, line, i));
+    }
+}
+
+void Table :: grow_columns (TableFile & tf)
+{
+    unsigned long old_capacity = tf.t_struct.capacity;
+    unsigned long new_capacity = old_capacity * 2;
+    if (new_capacity < COLUMN_START_CAPACITY)
+    {
+        new_capacity = COLUMN_START_CAPACITY;
+    }
+    table_files :: resize (tf, tf.t_struct.title_length + 
+                           new_capacity * tf.t_struct.row_length);
+    // segments are moved from the last one,
+    // the segment of flags stays on its place
+    for (unsigned long i = tf.t_struct.num_of_fields; i > 0; i--)
+    {
+        table_files :: move_data (tf, tf.t_struct.title_length + 
+                                  old_capacity * tf.offsets[i - 1], 
+                                  tf.t_struct.title_length + 
+                                  new_capacity * tf.offsets[i - 1], 
+                                  tf.t_struct.num_of_records * 
+                                  tf.widths[i - 1]);
+    }
+    tf.t_struct.capacity = new_capacity;
+    tf.title_dirty = true;
+    t_struct = tf.t_struct;
+}
+
+void Table :: shrink_columns (TableFile & tf)
+{
+    unsigned long new_capacity = max (tf.t_struct.num_of_records, 
+                                      (unsigned long) COLUMN_START_CAPACITY);
+    if (new_capacity >= tf.t_struct.capacity)
+    {
+        return;
+    }
+    // segments are moved from the first one,
+    // the segment of flags stays on its place
+    for (unsigned long i = 0; i < tf.t_struct.num_of_fields; i++)
+    {
+        table_files :: move_data (tf, tf.t_struct.title_length + 
+                                  tf.t_struct.capacity * tf.offsets[i], 
+                                  tf.t_struct.title_length + 
+                                  new_capacity * tf.offsets[i], 
+                                  tf.t_struct.num_of_records * 
+                                  tf.widths[i]);
+    }
+    table_files :: flush (tf);
+    table_files :: resize (tf, tf.t_struct.title_length + 
+                           new_capacity * tf.t_struct.row_length);
+    tf.t_struct.capacity = new_capacity;
+    tf.title_dirty = true;
+    t_struct = tf.t_struct;
+}
+
+void Table :: find_free (TableFile & tf)
+{
+    tf.free_lines.clear();
+    for (unsigned long j = 0; (j < tf.t_struct.num_of_records) && 
+         (tf.free_lines.size() < tf.t_struct.num_of_deleted); j++)
+    {
+        char flag;
+        table_files :: read_at (tf, &flag, ROW_FLAG_LEN, flag_pos (tf, j));
+        if (flag == ROW_DELETED)
+        {
+            tf.free_lines.insert (j);
+        }
+    }
+    tf.free_known = true;
+}
+
+bool Table :: encoded (TableFile & tf, unsigned long i)
+{
+    return (tf.fields[i].type == TEXT) && (tf.fields[i].l_num != 0);
+}
+
+// like pack_line, but with the places of fields in the file
+void Table :: pack_record (TableFile & tf, char * buf, bool learn)
+{
+    *buf = ROW_LIVE;
+    for (unsigned long i = 0; i < t_struct.num_of_fields; i++)
+    {
+        char * p = buf + tf.offsets[i];
+        if (encoded (tf, i))
+        {
+            unsigned short c = dict_code (tf, i, learn);
+            memcpy (p, &c, DICT_CODE_LEN);
+        }
+        else if (fields[i].type == TEXT)
+        {
+            // the rest of the field is filled with zeros
+            strncpy (p, fields[i].text, fields[i].field_len);
+        }
+        else
+        {
+            memcpy (p, &(fields[i].l_num), sizeof (long));
+        }
+    }
+}
+
+void Table :: unpack_record (TableFile & tf, const char * buf)
+{
+    for (unsigned long i = 0; i < t_struct.num_of_fields; i++)
+    {
+        unpack_value (tf, i, buf + tf.offsets[i]);
+    }
+}
+
+void Table :: unpack_value (TableFile & tf, unsigned long i, const char * p)
+{
+    if (!encoded (tf, i))
+    {
+        unpack_field (i, p);
+        return;
+    }
+    string text = text_value (tf, i, p);
+    memset (fields[i].text, 0, MAX_TEXT_LEN);
+    memcpy (fields[i].text, text.c_str(), text.length());
+}
+
+unsigned long Table :: dict_code (TableFile & tf, unsigned long i, 
+                                  bool learn)
+{
+    string text (fields[i].text, strnlen (fields[i].text, 
+                                          fields[i].field_len));
+    dictionary & d = tf.dicts[i];
+    map <string, unsigned long> :: iterator it = d.codes.find (text);
+    if (it != d.codes.end())
+    {
+        return it -> second;
+    }
+    // no record can have the text without the code
+    if (!learn)
+    {
+        throw TableException (TableException :: ESE_LINEFIND);
+    }
+    if (d.values.size() >= DICT_MAX_VALUES)
+    {
+        throw TableException (TableException :: ESE_DICTFULL);
+    }
+    table_files :: append_dict (tf, i, text);
+    return d.values.size() - 1;
+}
+
+string Table :: text_value (TableFile & tf, unsigned long i, const char * p)
+{
+    if (!encoded (tf, i))
+    {
+        // the text of full length has no zero at the end
+        return string (p, strnlen (p, tf.fields[i].field_len));
+    }
+    unsigned short c;
+    memcpy (&c, p, DICT_CODE_LEN);
+    if (c >= tf.dicts[i].values.size())
+    {
+        throw TableException (TableException :: ESE_FILEREAD);
+    }
+    return tf.dicts[i].values[c];
+}
+
+field_struct * Table :: get_field (const char n [MAX_FIELD_NAME_LEN])
+{
+    unsigned long i = 0; 
+    while ((i < t_struct.num_of_fields) && 
+            (strcmp (n, fields[i].name) != 0))
+    {
+        i++;
+    }
+    // if there is no such field or if there is no any fields
+    if (i == t_struct.num_of_fields)
+    {
+        throw TableException (TableException :: ESE_FIELDNAME);
+    }
+    else
+    {
+        return &fields[i];
+    }
+}
+
+unsigned long Table :: get_field_num (const char n [MAX_FIELD_NAME_LEN])
+{
+    return get_field (n) - &(fields[0]);
+}
+
+bool Table :: encoded (unsigned long i)
+{
+    return encoded (get_file (), i);
+}
+
+const vector <string> & Table :: dict_values (unsigned long i)
+{
+    return get_file ().dicts[i].values;
+}
+
+void Table :: add_line ()
+{
+    TableFile & tf = get_file ();
+    if (tf.t_struct.storage == COMPRESSED_STORAGE)
+    {
+        decompress (tf);
+    }
+    pack_record (tf, &(tf.line[0]), true);
+    // the first deleted record is taken before the file grows
+    if (tf.t_struct.num_of_deleted > 0)
+    {
+        if (!tf.free_known)
+        {
+            find_free (tf);
+        }
+        if (!tf.free_lines.empty())
+        {
+            unsigned long line = *(tf.free_lines.begin());
+            tf.free_lines.erase (tf.free_lines.begin());
+            write_record (tf, line);
+            tf.t_struct.num_of_deleted -= 1;
+            tf.title_dirty = true;
+            t_struct = tf.t_struct;
+            for (unsigned long i = 0; i < tf.indexes.size(); i++)
+            {
+                index_add (tf, tf.indexes[i], line + 1);
+            }
+            zone_add (tf, line + 1);
+            stat_touch (tf, line + 1);
+            return;
+        }
+    }
+    if ((tf.t_struct.storage == COLUMN_STORAGE) && 
+        (tf.t_struct.num_of_records == tf.t_struct.capacity))
+    {
+        grow_columns (tf);
+    }
+    if (tf.t_struct.storage == ROW_STORAGE)
+    {
+        // the record is collected with others in the tail of the file
+        table_files :: append (tf, &(tf.line[0]), tf.t_struct.row_length);
+    }
+    else
+    {
+        write_record (tf, tf.t_struct.num_of_records);
+    }
+    // changing the number of records in the table,
+    // the title is written at the end of the statement
+    tf.t_struct.num_of_records += 1;
+    tf.title_dirty = true;
+    t_struct = tf.t_struct;
+    for (unsigned long i = 0; i < tf.indexes.size(); i++)
+    {
+        index_add (tf, tf.indexes[i], tf.t_struct.num_of_records);
+    }
+    zone_add (tf, tf.t_struct.num_of_records);
+    stat_touch (tf, tf.t_struct.num_of_records);
+}
+
+unsigned long Table :: find_line ()
+{
+    TableFile & tf = get_file ();
+    // the data we search in the format of the file
+    vector <char> sample (t_struct.row_length);
+    pack_record (tf, &(sample[0]), false);
+    unsigned long line_num = 0;
+    // lines counter
+    unsigned long j = 0;
+    while (!line_num && (j < t_struct.num_of_records))
+    {
+        read_record (tf, j);
+        j++;
+        // if there is necessary line
+        if (memcmp (&(tf.line[0]), &(sample[0]), t_struct.row_length) == 0)
+        {
+            line_num = j;
+        }
+    }
+    // if there is no necessary line
+    if (line_num == 0)
+    {
+        throw TableException (TableException :: ESE_LINEFIND);
+    }
+    else
+    {
+        return line_num;
+    }
+}
+
+void Table :: delete_line ()
+{
+    // all fields take part in the search
+    use_all_fields ();
+    delete_line (find_line ());
+}
+
+void Table :: delete_line (const unsigned long line_num)
+{
+    delete_lines (vector <unsigned long> (1, line_num));
+}
+
+// the records stay in the file until vacuum, scans and searches skip them,
+// the title is written once for all records
+void Table :: delete_lines (const vector <unsigned long> & lines)
+{
+    // nothing is marked if any number is wrong
+    for (unsigned long i = 0; i < lines.size(); i++)
+    {
+        if ((lines[i] > t_struct.num_of_records) || (lines[i] <= 0) ||
+            ((i > 0) && (lines[i] <= lines[i - 1])))
+        {
+            throw TableException (TableException :: ESE_LINENUM);
+        }
+    }
+    if (lines.empty())
+    {
+        return;
+    }
+    TableFile & tf = get_file ();
+    if (tf.t_struct.storage == COMPRESSED_STORAGE)
+    {
+        decompress (tf);
+    }
+    bool missing = false;
+    for (unsigned long i = 0; i < lines.size(); i++)
+    {
+        char flag;
+        table_files :: read_at (tf, &flag, ROW_FLAG_LEN, 
+                                flag_pos (tf, lines[i] - 1));
+        // the record was deleted before
+        if (flag == ROW_DELETED)
+        {
+            missing = true;
+            continue;
+        }
+        for (unsigned long j = 0; j < tf.indexes.size(); j++)
+        {
+            index_remove (tf, tf.indexes[j], lines[i]);
+        }
+        flag = ROW_DELETED;
+        table_files :: write_at (tf, &flag, ROW_FLAG_LEN, 
+                                 flag_pos (tf, lines[i] - 1));
+        tf.t_struct.num_of_deleted += 1;
+        if (tf.free_known)
+        {
+            tf.free_lines.insert (lines[i] - 1);
+        }
+        stat_touch (tf, lines[i]);
+    }
+    tf.title_dirty = true;
+    t_struct = tf.t_struct;
+    if (missing)
+    {
+        throw TableException (TableException :: ESE_LINEFIND);
+    }
+}
+
+bool Table :: need_vacuum ()
+{
+    return (t_struct.num_of_deleted >= VACUUM_MIN_RECORDS) && 
+           (t_struct.num_of_deleted * 100 >= 
+            t_struct.num_of_records * VACUUM_PERCENT);
+}
+
+unsigned long Table :: vacuum ()
+{
+    unsigned long reclaimed;
+    return vacuum (reclaimed);
+}
+
+// not deleted records are moved to the beginning of the file
+// in one pass, the number of removed records is returned
+unsigned long Table :: vacuum (unsigned long & reclaimed)
+{
+    TableFile & tf = get_file ();
+    unsigned long removed = tf.t_struct.num_of_deleted;
+    reclaimed = 0;
+    if (removed == 0)
+    {
+        return 0;
+    }
+    off_t old_len = tf.file_len;
+    if (tf.t_struct.storage == COMPRESSED_STORAGE)
+    {
+        decompress (tf);
+    }
+    use_all_fields ();
+    unsigned long num = 0;
+    {
+        // the scanner reads blocks after the written records,
+        // so moved records do not change the data it reads
+        Scanner sc (*this);
+        while (sc.next ())
+        {
+            if (sc.line_num () - 1 != num)
+            {
+                sc.read ();
+                pack_record (tf, &(tf.line[0]), true);
+                write_record (tf, num);
+            }
+            num++;
+        }
+    }
+    tf.t_struct.num_of_records = num;
+    tf.t_struct.num_of_deleted = 0;
+    tf.title_dirty = true;
+    t_struct = tf.t_struct;
+    tf.free_lines.clear();
+    tf.free_known = true;
+    if (tf.t_struct.storage == ROW_STORAGE)
+    {
+        table_files :: flush (tf);
+        table_files :: resize (tf, tf.t_struct.title_length + 
+                               num * tf.t_struct.row_length);
+    }
+    else
+    {
+        shrink_columns (tf);
+    }
+    reclaimed = old_len - tf.file_len;
+    // the records got new numbers
+    for (unsigned long i = 0; i < tf.indexes.size(); i++)
+    {
+        build_index (tf, tf.indexes[i]);
+    }
+    if (table_files :: exists (string (tf.t_struct.table_name) + ".zone"))
+    {
+        build_zones (tf);
+    }
+    // statistics of all zones are made by the next ANALYZE
+    if (tf.analyzed)
+    {
+        TableFile & stf = table_files :: open_data (string (tf.t_struct.
+                                                            table_name) + 
+                                                    ".stat", false);
+        table_files :: resize (stf, stat_zone_pos (tf, 0));
+    }
+    return removed;
+}
+
+// all records are read before the file is written again
+bool Table :: compress (unsigned long & before, unsigned long & after)
+{
+    TableFile & tf = get_file ();
+    vacuum ();
+    table_files :: flush (tf);
+    before = tf.file_len - tf.t_struct.title_length;
+    after = before;
+    if (tf.t_struct.storage == COMPRESSED_STORAGE)
+    {
+        return false;
+    }
+    unsigned long num = tf.t_struct.num_of_records;
+    unsigned long nf = tf.t_struct.num_of_fields;
+    unsigned long zones = (num + ZONE_LINES - 1) / ZONE_LINES;
+    vector <column_block> blocks (zones * nf);
+    vector <char> data; // the values after the blocks
+    off_t start = tf.t_struct.title_length + 
+                  sizeof (struct column_block) * blocks.size();
+    use_all_fields ();
+    {
+        Scanner sc (*this);
+        vector <char> values;
+        vector <char> packed;
+        for (unsigned long z = 0; z < zones; z++)
+        {
+            unsigned long count = min ((unsigned long) ZONE_LINES, 
+                                       num - z * ZONE_LINES);
+            for (unsigned long i = 0; i < nf; i++)
+            {
+                unsigned long width = tf.widths[i];
+                values.resize (count * width);
+                for (unsigned long k = 0; k < count; k++)
+                {
+                    sc.go (z * ZONE_LINES + k + 1);
+                    memcpy (&(values[k * width]), sc.value (i), width);
+                }
+                if (tf.fields[i].type == LONG)
+                {
+                    codec :: pack_longs (&(values[0]), count, packed);
+                }
+                else
+                {
+                    codec :: lz_compress (&(values[0]), values.size(), 
+                                          packed);
+                }
+                blocks[z * nf + i].pos = start + data.size();
+                blocks[z * nf + i].len = packed.size();
+                data.insert (data.end(), packed.begin(), packed.end());
+            }
+        }
+    }
+    // the table is left as it is if compression doesn't help
+    after = sizeof (struct column_block) * blocks.size() + data.size();
+    if (after >= before)
+    {
+        return false;
+    }
+    // the old data is kept in the log for the rollback
+    table_files :: resize (tf, tf.t_struct.title_length);
+    if (!blocks.empty())
+    {
+        table_files :: write_at (tf, &(blocks[0]), 
+                                 sizeof (struct column_block) * 
+                                 blocks.size(), tf.t_struct.title_length);
+        table_files :: write_at (tf, &(data[0]), data.size(), start);
+    }
+    tf.t_struct.capacity = tf.t_struct.storage;
+    tf.t_struct.storage = COMPRESSED_STORAGE;
+    tf.title_dirty = true;
+    t_struct = tf.t_struct;
+    tf.zone_columns.clear();
+    catalog :: add (tf.t_struct, tf.fields);
+    return true;
+}
+
+void Table :: prepare_change ()
+{
+    TableFile & tf = get_file ();
+    if (tf.t_struct.storage == COMPRESSED_STORAGE)
+    {
+        decompress (tf);
+    }
+}
+
+// the table gets the storage it had before compression, the data is
+// written to the file at once, so scanners opened later read it
+void Table :: decompress (TableFile & tf)
+{
+    unsigned long num = tf.t_struct.num_of_records;
+    unsigned long zones = (num + ZONE_LINES - 1) / ZONE_LINES;
+    unsigned long storage = tf.t_struct.capacity;
+    unsigned long capacity = 0;
+    vector <char> image;
+    if (storage == ROW_STORAGE)
+    {
+        // the values of the zone are put to their records
+        image.assign (num * tf.t_struct.row_length, 0);
+        vector <char> values;
+        for (unsigned long z = 0; z < zones; z++)
+        {
+            unsigned long count = min ((unsigned long) ZONE_LINES, 
+                                       num - z * ZONE_LINES);
+            for (unsigned long i = 0; i < tf.t_struct.num_of_fields; i++)
+            {
+                unsigned long width = tf.widths[i];
+                values.resize (count * width);
+                load_block (tf, z, i, &(values[0]), false);
+                for (unsigned long k = 0; k < count; k++)
+                {
+                    memcpy (&(image[(z * ZONE_LINES + k) * 
+                                    tf.t_struct.row_length + 
+                                    tf.offsets[i]]), 
+                            &(values[k * width]), width);
+                }
+            }
+        }
+        for (unsigned long j = 0; j < num; j++)
+        {
+            image[j * tf.t_struct.row_length] = ROW_LIVE;
+        }
+    }
+    else
+    {
+        // the segments of columns with all values
+        capacity = max (num, (unsigned long) COLUMN_START_CAPACITY);
+        image.assign (capacity * tf.t_struct.row_length, 0);
+        memset (&(image[0]), ROW_LIVE, num);
+        for (unsigned long z = 0; z < zones; z++)
+        {
+            for (unsigned long i = 0; i < tf.t_struct.num_of_fields; i++)
+            {
+                load_block (tf, z, i, 
+                            &(image[capacity * tf.offsets[i] + 
+                                    z * ZONE_LINES * tf.widths[i]]), 
+                            false);
+            }
+        }
+    }
+    if (!image.empty())
+    {
+        table_files :: write_at (tf, &(image[0]), image.size(), 
+                                 tf.t_struct.title_length);
+    }
+    table_files :: resize (tf, tf.t_struct.title_length + image.size());
+    tf.t_struct.storage = storage;
+    tf.t_struct.capacity = capacity;
+    tf.title_dirty = true;
+    t_struct = tf.t_struct;
+    tf.zone_columns.clear();
+    table_files :: flush (tf);
+    catalog :: add (tf.t_struct, tf.fields);
+}
+
+void Table :: load_block (TableFile & tf, unsigned long zone, 
+                          unsigned long i, char * out, bool direct)
+{
+    column_block b;
+    off_t pos = tf.t_struct.title_length + sizeof (struct column_block) * 
+                (zone * tf.t_struct.num_of_fields + i);
+    if (direct)
+    {
+        table_files :: read_direct (tf, &b, sizeof (struct column_block), 
+                                    pos);
+    }
+    else
+    {
+        table_files :: read_at (tf, &b, sizeof (struct column_block), pos);
+    }
+    if ((b.len == 0) || (b.pos + b.len > (unsigned long) tf.file_len))
+    {
+        throw TableException (TableException :: ESE_FILEREAD);
+    }
+    vector <char> data (b.len);
+    if (direct)
+    {
+        table_files :: read_direct (tf, &(data[0]), b.len, b.pos);
+    }
+    else
+    {
+        table_files :: read_at (tf, &(data[0]), b.len, b.pos);
+    }
+    unsigned long count = min ((unsigned long) ZONE_LINES, 
+                               tf.t_struct.num_of_records - 
+                               zone * ZONE_LINES);
+    if (tf.fields[i].type == LONG)
+    {
+        codec :: unpack_longs (&(data[0]), b.len, count, out);
+    }
+    else
+    {
+        codec :: lz_decompress (&(data[0]), b.len, out, 
+                                count * tf.widths[i]);
+    }
+}
+
+const char * Table :: zone_value (TableFile & tf, unsigned long line, 
+                                  unsigned long i)
+{
+    unsigned long zone = line / ZONE_LINES;
+    if (tf.zone_columns.empty() || (tf.cached_zone != zone))
+    {
+        tf.zone_columns.assign (tf.t_struct.num_of_fields, vector <char> ());
+        tf.cached_zone = zone;
+    }
+    vector <char> & values = tf.zone_columns[i];
+    if (values.empty())
+    {
+        unsigned long count = min ((unsigned long) ZONE_LINES, 
+                                   tf.t_struct.num_of_records - 
+                                   zone * ZONE_LINES);
+        values.resize (count * tf.widths[i]);
+        load_block (tf, zone, i, &(values[0]), false);
+    }
+    return &(values[(line % ZONE_LINES) * tf.widths[i]]);
+}
+
+void Table :: update_line (const unsigned long line_num)
+{
+    if ((line_num > t_struct.num_of_records) || 
+        (line_num <= 0))
+    {
+        throw TableException (TableException :: ESE_LINENUM);
+    }
+    TableFile & tf = get_file ();
+    if (tf.t_struct.storage == COMPRESSED_STORAGE)
+    {
+        decompress (tf);
+    }
+    // the old values leave the indexes before the buffer gets the new ones
+    vector <bool> changed;
+    for (unsigned long i = 0; i < tf.indexes.size(); i++)
+    {
+        changed.push_back (index_changed (tf.indexes[i], line_num));
+        if (changed[i])
+        {
+            index_remove (tf, tf.indexes[i], line_num);
+        }
+    }
+    pack_record (tf, &(tf.line[0]), true);
+    // rewrite data
+    write_record (tf, line_num - 1);
+    for (unsigned long i = 0; i < tf.indexes.size(); i++)
+    {
+        if (changed[i])
+        {
+            index_add (tf, tf.indexes[i], line_num);
+        }
+    }
+    // the old values stay in the ranges, they are only wider than needed
+    zone_add (tf, line_num);
+    stat_touch (tf, line_num);
+}
+
+void Table :: create_index (string i_name, string f_name, index_type type,
+                            unsigned long bits)
+{
+    if (i_name.empty() || (i_name.length() > MAX_INDEX_NAME_LEN))
+    {
+        throw TableException (TableException :: ESE_INDEXNAME);
+    }
+    // the filter takes whole bytes
+    bits = (bits + 7) / 8 * 8;
+    if ((type == BLOOM_INDEX) && ((bits == 0) || (bits > BLOOM_MAX_BITS)))
+    {
+        throw TableException (TableException :: ESE_INDEXSIZE);
+    }
+    TableFile & tf = get_file ();
+    for (unsigned long i = 0; i < tf.indexes.size(); i++)
+    {
+        if (i_name == tf.indexes[i].name)
+        {
+            throw TableException (TableException :: ESE_INDEXNAME);
+        }
+    }
+    field_struct * f = get_field (f_name.c_str());
+    // the B+tree keeps numbers, other indexes keep texts
+    if ((type == BTREE_INDEX) != (f -> type == LONG))
+    {
+        throw TableException (TableException :: ESE_FIELDTYPE);
+    }
+    index_struct idx;
+    memset (&idx, 0, sizeof (struct index_struct));
+    strncpy (idx.name, i_name.c_str(), MAX_INDEX_NAME_LEN);
+    strncpy (idx.field_name, f -> name, MAX_FIELD_NAME_LEN);
+    idx.type = type;
+    TableFile & itf = table_files :: open_data (table_files :: 
+                                                index_file_name (tf, idx), 
+                                                true);
+    // the size of filters is kept in the file for next builds
+    if (type == BLOOM_INDEX)
+    {
+        bloom_meta meta;
+        bloom :: make_meta (meta, bits);
+        bloom :: write_meta (itf, meta);
+    }
+    build_index (tf, idx);
+    // the table knows the index when it is built
+    tf.indexes.push_back (idx);
+    table_files :: save_indexes (tf);
+}
+
+index_struct * Table :: find_index (unsigned long i, index_type type)
+{
+    TableFile & tf = get_file ();
+    for (unsigned long j = 0; j < tf.indexes.size(); j++)
+    {
+        if ((tf.indexes[j].type == (unsigned long) type) && 
+            (strncmp (tf.indexes[j].field_name, fields[i].name, 
+                      MAX_FIELD_NAME_LEN) == 0))
+        {
+            return &(tf.indexes[j]);
+        }
+    }
+    return NULL;
+}
+
+void Table :: index_find (index_struct & idx, long from, long to, 
+                          vector <unsigned long> & rows)
+{
+    btree :: find (index_file (get_file (), idx), from, to, rows);
+}
+
+void Table :: index_find (index_struct & idx, string text, 
+                          vector <unsigned long> & rows)
+{
+    hash_index :: find (index_file (get_file (), idx), text, rows);
+}
+
+void Table :: index_find (index_struct & idx, const vector <string> & parts,
+                          vector <unsigned long> & rows)
+{
+    trigram_index :: find (index_file (get_file (), idx), parts, rows);
+}
+
+void Table :: index_zones (index_struct & idx, const vector <string> & texts,
+                           vector <bool> & absent)
+{
+    bloom :: find (index_file (get_file (), idx), texts, absent);
+}
+
+TableFile & Table :: index_file (TableFile & tf, index_struct & idx)
+{
+    return table_files :: open_data (table_files :: index_file_name (tf, idx),
+                                     false);
+}
+
+// the index is built again from all not deleted records
+void Table :: build_index (TableFile & tf, index_struct & idx)
+{
+    TableFile & itf = index_file (tf, idx);
+    unsigned long f_num = get_field_num (idx.field_name);
+    vector <btree_item> items;
+    vector <hash_item> texts;
+    use_fields (vector <string> (1, string (idx.field_name)));
+    {
+        Scanner sc (*this);
+        while (sc.next ())
+        {
+            if (idx.type == BTREE_INDEX)
+            {
+                btree_item item = {sc.get_long (f_num), sc.line_num (), 0};
+                items.push_back (item);
+            }
+            else if (idx.type == TRIGRAM_INDEX)
+            {
+                vector <long> keys;
+                trigram_index :: codes (sc.get_text (f_num), keys);
+                for (unsigned long i = 0; i < keys.size(); i++)
+                {
+                    btree_item item = {keys[i], sc.line_num (), 0};
+                    items.push_back (item);
+                }
+            }
+            else
+            {
+                hash_item item;
+                hash_index :: make_item (item, sc.get_text (f_num), 
+                                         sc.line_num ());
+                texts.push_back (item);
+            }
+        }
     }
-    // a temporary file for table without the line
-    FILE * tmp = fopen ("tmp.txt", "wb");
-    if (tmp == NULL)
+    use_all_fields ();
+    bloom_meta meta;
+    if (idx.type == BLOOM_INDEX)
     {
-        throw TableException (TableException :: ESE_FILEOPEN);
+        bloom :: read_meta (itf, meta);
     }
-    // changing the number of records
-    t_struct.num_of_records -= 1;
-    // title in temporary file
-    if (fwrite (&(t_struct), sizeof (struct table_struct), 1, tmp) == 0)
+    // the old pages are kept in the log for the rollback
+    table_files :: resize (itf, 0);
+    if (idx.type == BLOOM_INDEX)
     {
-        throw TableException (TableException :: ESE_FILEWRITE);
+        bloom :: build (itf, meta, texts);
     }
-    for (unsigned long i = 0; i < t_struct.num_of_fields; i++)
+    else if (idx.type != HASH_INDEX)
     {
-        strcpy (fields[i].text, "");
-        fields[i].l_num = 0;
-        if (fwrite (&(fields[i]), sizeof (fields[i]), 1, tmp) == 0)
-        {
-            throw TableException (TableException :: ESE_FILEWRITE);
-        }
+        sort (items.begin(), items.end(), btree :: item_less);
+        btree :: build (itf, items);
+    }
+    else
+    {
+        hash_index :: build (itf, texts, 
+                             hash_index :: buckets_for (texts.size()));
+    }
+}
+
+void Table :: index_add (TableFile & tf, index_struct & idx, 
+                         unsigned long line_num)
+{
+    field_struct & f = fields[get_field_num (idx.field_name)];
+    // the record keeps field_len bytes of the text
+    string text (f.text, strnlen (f.text, f.field_len));
+    if (idx.type == BTREE_INDEX)
+    {
+        btree :: insert (index_file (tf, idx), f.l_num, line_num);
+    }
+    else if (idx.type == TRIGRAM_INDEX)
+    {
+        trigram_index :: insert (index_file (tf, idx), text, line_num);
+    }
+    else if (idx.type == BLOOM_INDEX)
+    {
+        bloom :: insert (index_file (tf, idx), text, line_num);
+    }
+    else
+    {
+        hash_index :: insert (index_file (tf, idx), text, line_num);
+    }
+}
+
+void Table :: index_remove (TableFile & tf, index_struct & idx, 
+                            unsigned long line_num)
+{
+    unsigned long f_num = get_field_num (idx.field_name);
+    if (idx.type == BTREE_INDEX)
+    {
+        btree :: erase (index_file (tf, idx), get_long (line_num, f_num), 
+                        line_num);
+    }
+    else if (idx.type == TRIGRAM_INDEX)
+    {
+        trigram_index :: erase (index_file (tf, idx), 
+                                get_text (line_num, f_num), line_num);
+    }
+    else if (idx.type == BLOOM_INDEX)
+    {
+        // the filter keeps the text until the next build
+        return;
     }
-    if (fseek (f, t_struct.title_length, SEEK_SET) != 0)
+    else
+    {
+        hash_index :: erase (index_file (tf, idx), 
+                             get_text (line_num, f_num), line_num);
+    }
+}
+
+bool Table :: index_changed (index_struct & idx, unsigned long line_num)
+{
+    unsigned long f_num = get_field_num (idx.field_name);
+    if (idx.type == BTREE_INDEX)
     {
-        throw TableException (TableException :: ESE_FILESEEK);
+        return get_long (line_num, f_num) != fields[f_num].l_num;
     }
-    // lines before the line we have to delete
-    for (unsigned long j = 0; j < line_num - 1; j++)
+    return get_text (line_num, f_num) != 
+           string (fields[f_num].text, strnlen (fields[f_num].text, 
+                                                fields[f_num].field_len));
+}
+
+vector <unsigned long> Table :: zone_fields (TableFile & tf)
+{
+    vector <unsigned long> longs;
+    for (unsigned long i = 0; i < tf.t_struct.num_of_fields; i++)
     {
-        for (unsigned long i = 0; i < t_struct.num_of_fields; i++)
+        if (tf.fields[i].type == LONG)
         {
-            struct field_struct f_struct;
-            if (fread (&(f_struct), sizeof (f_struct), 1, f) == 0)
-            {
-                throw TableException (TableException :: ESE_FILEREAD);
-            }
-            if (fwrite (&(f_struct), sizeof (f_struct), 1, tmp) == 0)
-            {
-                throw TableException (TableException :: ESE_FILEWRITE);
-            }
+            longs.push_back (i);
         }
     }
-    // moving the pointer through the line we have to delete
-    if (fseek (f, sizeof (struct field_struct) * t_struct.num_of_fields, 
-               SEEK_CUR) != 0)
+    return longs;
+}
+
+TableFile & Table :: zone_file (TableFile & tf)
+{
+    string file_name = string (tf.t_struct.table_name) + ".zone";
+    // tables made before zone maps get them here
+    if (!table_files :: exists (file_name))
+    {
+        build_zones (tf);
+    }
+    return table_files :: open_data (file_name, false);
+}
+
+// the zone map is made again from all not deleted records
+void Table :: build_zones (TableFile & tf)
+{
+    vector <unsigned long> longs = zone_fields (tf);
+    unsigned long zones = (tf.t_struct.num_of_records + ZONE_LINES - 1) / 
+                          ZONE_LINES;
+    zone_range none = {LONG_MAX, LONG_MIN};
+    vector <zone_range> ranges (zones * longs.size(), none);
+    vector <string> names;
+    for (unsigned long j = 0; j < longs.size(); j++)
     {
-        throw TableException (TableException :: ESE_FILESEEK);
+        names.push_back (string (fields[longs[j]].name));
     }
-    // lines after the line we have to delete
-    for (unsigned long j = line_num; j < t_struct.num_of_records + 1; 
-         j++)
+    if (!longs.empty())
     {
-        for (unsigned long i = 0; i < t_struct.num_of_fields; i++)
+        use_fields (names);
+        Scanner sc (*this);
+        while (sc.next ())
         {
-            struct field_struct f_struct;
-            if (fread (&(f_struct), sizeof (f_struct), 1, f) == 0)
-            {
-                throw TableException (TableException :: ESE_FILEREAD);
-            }
-            if (fwrite (&(f_struct), sizeof (f_struct), 1, tmp) == 0)
+            zone_range * r = &(ranges[(sc.line_num () - 1) / ZONE_LINES * 
+                                      longs.size()]);
+            for (unsigned long j = 0; j < longs.size(); j++)
             {
-                throw TableException (TableException :: ESE_FILEWRITE);
+                long num = sc.get_long (longs[j]);
+                r[j].min = min (r[j].min, num);
+                r[j].max = max (r[j].max, num);
             }
         }
     }
-    fclose (f);
-    // deleting the file we used
-    if (remove (file_name.c_str()) != 0)
+    use_all_fields ();
+    string file_name = string (tf.t_struct.table_name) + ".zone";
+    bool fresh = !table_files :: exists (file_name);
+    TableFile & ztf = table_files :: open_data (file_name, fresh);
+    // the old ranges are kept in the log for the rollback
+    if (!fresh)
     {
-        throw TableException (TableException :: ESE_FILEREMOVE);
+        table_files :: resize (ztf, 0);
     }
-    fclose (tmp);
-    // rename the temporary file
-    // it becomes a main file we work
-    if (rename ("tmp.txt", file_name.c_str()) != 0)
+    if (!ranges.empty())
     {
-        throw TableException (TableException :: ESE_FILERENAME);
+        table_files :: write_at (ztf, &(ranges[0]), sizeof (struct zone_range)
+                                 * ranges.size(), 0);
     }
 }
 
-void Table :: update_line (const unsigned long line_num)
+void Table :: zone_add (TableFile & tf, unsigned long line_num)
 {
-    if ((line_num > t_struct.num_of_records) || 
-        (line_num <= 0))
+    vector <unsigned long> longs = zone_fields (tf);
+    if (longs.empty())
     {
-        throw TableException (TableException :: ESE_LINENUM);
+        return;
     }
-    string t_name = string (t_struct.table_name, 
-                            strlen (t_struct.table_name));
-    string file_name = t_name + ".txt";
-    FILE * f = fopen (file_name.c_str(), "rb+");
-    if (f == NULL)
+    TableFile & ztf = zone_file (tf);
+    size_t len = sizeof (struct zone_range) * longs.size();
+    off_t pos = (line_num - 1) / ZONE_LINES * len;
+    zone_range none = {LONG_MAX, LONG_MIN};
+    vector <zone_range> ranges (longs.size(), none);
+    // the first record of the zone begins its ranges
+    bool changed = (pos + (off_t) len > ztf.file_len);
+    if (!changed)
     {
-        throw TableException (TableException :: ESE_FILEOPEN);
+        table_files :: read_at (ztf, &(ranges[0]), len, pos);
     }
-    if (fseek (f, t_struct.title_length, SEEK_SET) != 0)
+    for (unsigned long j = 0; j < longs.size(); j++)
     {
-        throw TableException (TableException :: ESE_FILESEEK);
+        long num = fields[longs[j]].l_num;
+        if ((num < ranges[j].min) || (num > ranges[j].max))
+        {
+            ranges[j].min = min (ranges[j].min, num);
+            ranges[j].max = max (ranges[j].max, num);
+            changed = true;
+        }
     }
-    // moving through lines before the line we need
-    if (fseek (f, sizeof (struct field_struct) * t_struct.num_of_fields 
-               * (line_num - 1) , SEEK_CUR) != 0)
+    if (changed)
     {
-        throw TableException (TableException :: ESE_FILESEEK);
+        table_files :: write_at (ztf, &(ranges[0]), len, pos);
     }
-    // rewrite data
-    for (unsigned long i = 0; i < t_struct.num_of_fields; i++)
+}
+
+void Table :: zone_ranges (unsigned long f_num, vector <zone_range> & out)
+{
+    out.clear();
+    TableFile & tf = get_file ();
+    vector <unsigned long> longs = zone_fields (tf);
+    unsigned long j = find (longs.begin(), longs.end(), f_num) - 
+                      longs.begin();
+    if (j == longs.size())
     {
-        if (fwrite (&(fields[i]), sizeof (fields[i]), 1, f) == 0)
-        {
-            throw TableException (TableException :: ESE_FILEWRITE);
-        }
+        return;
+    }
+    TableFile & ztf = zone_file (tf);
+    vector <zone_range> ranges (ztf.file_len / sizeof (struct zone_range));
+    if (!ranges.empty())
+    {
+        table_files :: read_at (ztf, &(ranges[0]), sizeof (struct zone_range)
+                                * ranges.size(), 0);
+    }
+    for (unsigned long z = 0; (z + 1) * longs.size() <= ranges.size(); z++)
+    {
+        out.push_back (ranges[z * longs.size() + j]);
     }
-    fclose (f);
 }
 
-void Table :: read_first ()
+off_t Table :: stat_zone_pos (TableFile & tf, unsigned long zone)
 {
-    // check if the table is empty
-    if (t_struct.num_of_records == 0)
+    unsigned long nf = tf.t_struct.num_of_fields;
+    return sizeof (struct stat_head) + sizeof (struct column_stats) * nf + 
+           (sizeof (unsigned long) + sizeof (struct zone_stats) * nf) * zone;
+}
+
+void Table :: stat_touch (TableFile & tf, unsigned long line_num)
+{
+    if (!tf.analyzed)
     {
-        throw TableException (TableException :: ESE_LINEFIND);
+        return;
     }
-    string t_name = string (t_struct.table_name, 
-                            strlen (t_struct.table_name));
-    string file_name = t_name + ".txt";
-    FILE * f = fopen (file_name.c_str(), "rb+");
-    if (f == NULL)
+    TableFile & stf = table_files :: open_data (string (tf.t_struct.
+                                                        table_name) + 
+                                                ".stat", false);
+    off_t pos = stat_zone_pos (tf, (line_num - 1) / ZONE_LINES);
+    // zones after the end of the file have no statistics yet
+    if (pos + (off_t) sizeof (unsigned long) > stf.file_len)
     {
-        throw TableException (TableException :: ESE_FILEOPEN);
+        return;
     }
-    if (fseek (f, t_struct.title_length, SEEK_SET) != 0)
+    unsigned long changed;
+    table_files :: read_at (stf, &changed, sizeof (unsigned long), pos);
+    if (!changed)
     {
-        throw TableException (TableException :: ESE_FILESEEK);
+        changed = 1;
+        table_files :: write_at (stf, &changed, sizeof (unsigned long), pos);
     }
-    for (unsigned long i = 0; i < t_struct.num_of_fields; i++)
+}
+
+// statistics of zones without changes are taken from the file
+void Table :: analyze (unsigned long & read, unsigned long & zones)
+{
+    TableFile & tf = get_file ();
+    unsigned long nf = tf.t_struct.num_of_fields;
+    zones = (tf.t_struct.num_of_records + ZONE_LINES - 1) / ZONE_LINES;
+    string file_name = string (tf.t_struct.table_name) + ".stat";
+    TableFile & stf = table_files :: open_data (file_name, !tf.analyzed);
+    tf.analyzed = true;
+    size_t entry = sizeof (unsigned long) + sizeof (struct zone_stats) * nf;
+    vector <zone_stats> all (zones * nf);
+    vector <bool> skipped (zones, false);
+    read = zones;
+    for (unsigned long z = 0; z < zones; z++)
     {
-        if (fread (&(fields[i]), sizeof (fields[i]), 1, f) == 0)
+        off_t pos = stat_zone_pos (tf, z);
+        if (pos + (off_t) entry > stf.file_len)
         {
-            throw TableException (TableException :: ESE_FILEREAD);
+            break;
+        }
+        unsigned long changed;
+        table_files :: read_at (stf, &changed, sizeof (unsigned long), pos);
+        if (!changed && (nf != 0))
+        {
+            table_files :: read_at (stf, &(all[z * nf]), 
+                                    sizeof (struct zone_stats) * nf, 
+                                    pos + sizeof (unsigned long));
+            skipped[z] = true;
+            read--;
+        }
+    }
+    // zones without records get empty statistics
+    vector <long> no_longs;
+    for (unsigned long j = 0; j < all.size(); j++)
+    {
+        if (!skipped[j / nf])
+        {
+            stats :: zone_longs (no_longs, all[j]);
+        }
+    }
+    use_all_fields ();
+    {
+        Scanner sc (*this);
+        sc.skip_zones (skipped);
+        vector <vector <long> > longs (nf);
+        vector <vector <string> > texts (nf);
+        unsigned long zone = 0;
+        bool more = sc.next ();
+        while (more)
+        {
+            zone = (sc.line_num () - 1) / ZONE_LINES;
+            for (unsigned long i = 0; i < nf; i++)
+            {
+                if (tf.fields[i].type == LONG)
+                {
+                    longs[i].push_back (sc.get_long (i));
+                }
+                else
+                {
+                    texts[i].push_back (sc.get_text (i));
+                }
+            }
+            more = sc.next ();
+            // the values of the zone are collected
+            if (!more || ((sc.line_num () - 1) / ZONE_LINES != zone))
+            {
+                for (unsigned long i = 0; i < nf; i++)
+                {
+                    if (tf.fields[i].type == LONG)
+                    {
+                        stats :: zone_longs (longs[i], all[zone * nf + i]);
+                    }
+                    else
+                    {
+                        stats :: zone_texts (texts[i], all[zone * nf + i]);
+                    }
+                    longs[i].clear();
+                    texts[i].clear();
+                }
+            }
+        }
+    }
+    vector <char> buf (entry, 0);
+    for (unsigned long z = 0; z < zones; z++)
+    {
+        if (!skipped[z] && (nf != 0))
+        {
+            memcpy (&(buf[sizeof (unsigned long)]), &(all[z * nf]), 
+                    sizeof (struct zone_stats) * nf);
+            table_files :: write_at (stf, &(buf[0]), entry, 
+                                     stat_zone_pos (tf, z));
         }
     }
-    fclose (f);
+    if (stf.file_len > stat_zone_pos (tf, zones))
+    {
+        table_files :: resize (stf, stat_zone_pos (tf, zones));
+    }
+    stat_head head;
+    head.num_of_records = tf.t_struct.num_of_records - 
+                          tf.t_struct.num_of_deleted;
+    head.num_of_fields = nf;
+    table_files :: write_at (stf, &head, sizeof (struct stat_head), 0);
+    for (unsigned long i = 0; i < nf; i++)
+    {
+        column_stats col;
+        stats :: merge (all, i, nf, tf.fields[i].type == LONG, col);
+        table_files :: write_at (stf, &col, sizeof (struct column_stats), 
+                                 sizeof (struct stat_head) + 
+                                 sizeof (struct column_stats) * i);
+    }
 }
 
-void Table :: read_line (const unsigned long line_num)
+bool Table :: get_stats (unsigned long f_num, column_stats & out)
 {
-    if ((line_num > t_struct.num_of_records) || 
-        (line_num <= 0))
+    TableFile & tf = get_file ();
+    if (!tf.analyzed)
     {
-        throw TableException (TableException :: ESE_LINENUM);
+        return false;
     }
-    string t_name = string (t_struct.table_name, 
-                            strlen (t_struct.table_name));
-    string file_name = t_name + ".txt";
-    FILE * f = fopen (file_name.c_str(), "rb+");
-    if (f == NULL)
+    TableFile & stf = table_files :: open_data (string (tf.t_struct.
+                                                        table_name) + 
+                                                ".stat", false);
+    off_t pos = sizeof (struct stat_head) + 
+                sizeof (struct column_stats) * f_num;
+    if ((f_num >= tf.t_struct.num_of_fields) || 
+        (pos + (off_t) sizeof (struct column_stats) > stf.file_len))
     {
-        throw TableException (TableException :: ESE_FILEOPEN);
+        return false;
     }
-    if (fseek (f, t_struct.title_length, SEEK_SET) != 0)
+    table_files :: read_at (stf, &out, sizeof (struct column_stats), pos);
+    return true;
+}
+
+void Table :: read_first ()
+{
+    // check if the table is empty
+    if (t_struct.num_of_records == 0)
     {
-        throw TableException (TableException :: ESE_FILESEEK);
+        throw TableException (TableException :: ESE_LINEFIND);
     }
-    // moving through lines before the line we need
-    if (fseek (f, sizeof (struct field_struct) * t_struct.num_of_fields
-               * (line_num - 1) , SEEK_CUR) != 0)
+    read_line (1);
+}
+
+void Table :: read_line (const unsigned long line_num)
+{
+    if ((line_num > t_struct.num_of_records) || 
+        (line_num <= 0))
     {
-        throw TableException (TableException :: ESE_FILESEEK);
+        throw TableException (TableException :: ESE_LINENUM);
     }
-    for (unsigned long i = 0; i < t_struct.num_of_fields; i++)
+    TableFile & tf = get_file ();
+    if (tf.t_struct.storage == ROW_STORAGE)
     {
-        if (fread (&(fields[i]), sizeof (fields[i]), 1, f) == 0)
-        {
-            throw TableException (TableException :: ESE_FILEREAD);
-        }
+        // the data of the fields is taken right from the pool page
+        unpack_record (tf, table_files :: view (tf, flag_pos (tf, 
+                                                              line_num - 1),
+                                                tf.t_struct.row_length, 
+                                                &(tf.line[0])));
+        return;
     }
-    fclose (f);
+    read_record (tf, line_num - 1);
+    unpack_record (tf, &(tf.line[0]));
 }
 
 void Table :: read_next ()
@@ -635,6 +5597,11 @@ void Table :: print_line_names ()
 void Table :: print_line (const unsigned long line_num)
 {
     read_line (line_num);
+    print_fields ();
+}
+
+void Table :: print_fields ()
+{
     for (unsigned long i = 0; i < t_struct.num_of_fields; i++)
     {
         unsigned long wid;
@@ -667,9 +5634,11 @@ void Table :: print_table ()
     cout << endl;
     cout << t_struct.table_name << endl;
     print_line_names ();
-    for (unsigned long i = 1; i <= t_struct.num_of_records; i++)
+    Scanner sc (*this);
+    while (sc.next ())
     {
-        print_line (i);
+        sc.read ();
+        print_fields ();
     }
     cout << endl;
 }
@@ -708,6 +5677,11 @@ void Table :: print_short_line_names (vector <string> vect)
 void Table :: print_short_line (vector <string> vect, unsigned long num)
 {
     read_line (num);
+    print_short_fields (vect);
+}
+
+void Table :: print_short_fields (vector <string> vect)
+{
     for (unsigned long i = 0; i < vect.size(); i++)
     {
         field_struct * f = get_field (vect[i].c_str());
@@ -731,4 +5705,255 @@ void Table :: print_short_line (vector <string> vect, unsigned long num)
     cout << endl;
 }
 
+
+/*---------------Table::Scanner---------------*/
+Table :: Scanner :: Scanner (Table & t) : table (t), tf (t.get_file ())
+{
+    // the scanner reads the disk, so changed pages are written before
+    buffer_pool :: flush (tf);
+    block_lines = SCAN_BUF_SIZE / tf.t_struct.row_length;
+    // the compressed table is read by zones
+    if (tf.t_struct.storage == COMPRESSED_STORAGE)
+    {
+        block_lines = ZONE_LINES;
+    }
+    if (block_lines == 0)
+    {
+        block_lines = 1;
+    }
+    buf.resize (block_lines * tf.t_struct.row_length);
+    first = 0;
+    count = 0;
+    cur = 0;
+    batch_start = 1;
+    table_files :: advise (tf, SEQUENTIAL_ACCESS);
+}
+
+Table :: Scanner :: ~ Scanner ()
+{
+    table_files :: advise (tf, NORMAL_ACCESS);
+}
+
+// reading the block beginning with the record line (from 0)
+void Table :: Scanner :: load (unsigned long line)
+{
+    if (tf.t_struct.storage == COMPRESSED_STORAGE)
+    {
+        // the zone of the record is decompressed, all its records are live
+        first = line / ZONE_LINES * ZONE_LINES;
+        count = min ((unsigned long) ZONE_LINES, 
+                     table.t_struct.num_of_records - first);
+        io_stats :: cur.scan_blocks++;
+        memset (&(buf[0]), ROW_LIVE, count);
+        for (unsigned long i = 0; i < tf.t_struct.num_of_fields; i++)
+        {
+            if (table.used_fields.empty() || table.used_fields[i])
+            {
+                table.load_block (tf, first / ZONE_LINES, i, 
+                                  &(buf[block_lines * tf.offsets[i]]), true);
+            }
+        }
+        return;
+    }
+    first = line;
+    count = table.t_struct.num_of_records - line;
+    if (count > block_lines)
+    {
+        count = block_lines;
+    }
+    // the block ends before the next skipped zone
+    for (unsigned long z = line / ZONE_LINES + 1; 
+         (z * ZONE_LINES < line + count) && (z < skipped.size()); z++)
+    {
+        if (skipped[z])
+        {
+            count = z * ZONE_LINES - line;
+        }
+    }
+    io_stats :: cur.scan_blocks++;
+    if (tf.t_struct.storage == ROW_STORAGE)
+    {
+        table_files :: read_direct (tf, &(buf[0]), 
+                                    count * tf.t_struct.row_length, 
+                                    table.flag_pos (tf, line));
+        return;
+    }
+    // the part of the segment of flags and of every necessary field
+    table_files :: read_direct (tf, &(buf[0]), count * ROW_FLAG_LEN, 
+                                table.flag_pos (tf, line));
+    for (unsigned long i = 0; i < tf.t_struct.num_of_fields; i++)
+    {
+        if (table.used_fields.empty() || table.used_fields[i])
+        {
+            table_files :: read_direct (tf, &(buf[block_lines * 
+                                               tf.offsets[i]]), 
+                                        count * tf.widths[i], 
+                                        table.field_pos (tf, line, i));
+        }
+    }
+}
+
+bool Table :: Scanner :: next ()
+{
+    do
+    {
+        unsigned long line = cur + 1;
+        // records of skipped zones are not read
+        while ((line <= table.t_struct.num_of_records) && 
+               ((line - 1) / ZONE_LINES < skipped.size()) && 
+               skipped[(line - 1) / ZONE_LINES])
+        {
+            line = ((line - 1) / ZONE_LINES + 1) * ZONE_LINES + 1;
+            io_stats :: cur.zone_skips++;
+        }
+        if (line > table.t_struct.num_of_records)
+        {
+            cur = table.t_struct.num_of_records;
+            return false;
+        }
+        go (line);
+    }
+    while (deleted ());
+    return true;
+}
+
+void Table :: Scanner :: skip_zones (const vector <bool> & zones)
+{
+    skipped = zones;
+}
+
+void Table :: Scanner :: go (const unsigned long line_num)
+{
+    if ((line_num > table.t_struct.num_of_records) || 
+        (line_num <= 0))
+    {
+        throw TableException (TableException :: ESE_LINENUM);
+    }
+    cur = line_num;
+    if ((cur - 1 < first) || (cur - 1 >= first + count))
+    {
+        load (cur - 1);
+    }
+}
+
+bool Table :: Scanner :: deleted ()
+{
+    if (tf.t_struct.storage == ROW_STORAGE)
+    {
+        return buf[(cur - 1 - first) * tf.t_struct.row_length] == 
+               ROW_DELETED;
+    }
+    return buf[cur - 1 - first] == ROW_DELETED;
+}
+
+unsigned long Table :: Scanner :: line_num ()
+{
+    return cur;
+}
+
+const char * Table :: Scanner :: value (unsigned long i)
+{
+    if (tf.t_struct.storage == ROW_STORAGE)
+    {
+        return &(buf[(cur - 1 - first) * tf.t_struct.row_length + 
+                     tf.offsets[i]]);
+    }
+    return &(buf[block_lines * tf.offsets[i] + 
+                 (cur - 1 - first) * tf.widths[i]]);
+}
+
+long Table :: Scanner :: get_long (unsigned long i)
+{
+    long num;
+    memcpy (&num, value (i), sizeof (long));
+    return num;
+}
+
+string Table :: Scanner :: get_text (unsigned long i)
+{
+    return table.text_value (tf, i, value (i));
+}
+
+unsigned long Table :: Scanner :: code (unsigned long i)
+{
+    unsigned short c;
+    memcpy (&c, value (i), DICT_CODE_LEN);
+    return c;
+}
+
+void Table :: Scanner :: read ()
+{
+    for (unsigned long i = 0; i < tf.t_struct.num_of_fields; i++)
+    {
+        if (table.used_fields.empty() || table.used_fields[i])
+        {
+            table.unpack_value (tf, i, value (i));
+        }
+    }
+}
+
+unsigned long Table :: Scanner :: next_batch ()
+{
+    unsigned long line = cur + 1;
+    // records of skipped zones are not read
+    while ((line <= table.t_struct.num_of_records) && 
+           ((line - 1) / ZONE_LINES < skipped.size()) && 
+           skipped[(line - 1) / ZONE_LINES])
+    {
+        line = ((line - 1) / ZONE_LINES + 1) * ZONE_LINES + 1;
+        io_stats :: cur.zone_skips++;
+    }
+    if (line > table.t_struct.num_of_records)
+    {
+        cur = table.t_struct.num_of_records;
+        return 0;
+    }
+    go (line);
+    unsigned long n = min (first + count - (line - 1), 
+                           (unsigned long) BATCH_LINES);
+    batch_start = line;
+    cur = line + n - 1;
+    return n;
+}
+
+unsigned long Table :: Scanner :: batch_first ()
+{
+    return batch_start;
+}
+
+void Table :: Scanner :: batch_longs (unsigned long i, long * out)
+{
+    unsigned long n = cur - batch_start + 1;
+    unsigned long k = batch_start - 1 - first;
+    // values of the field lie together in the block of columns
+    if (tf.t_struct.storage != ROW_STORAGE)
+    {
+        memcpy (out, &(buf[block_lines * tf.offsets[i] + k * sizeof (long)]),
+                n * sizeof (long));
+        return;
+    }
+    const char * p = &(buf[k * tf.t_struct.row_length + tf.offsets[i]]);
+    for (unsigned long j = 0; j < n; j++)
+    {
+        memcpy (&(out[j]), p, sizeof (long));
+        p += tf.t_struct.row_length;
+    }
+}
+
+void Table :: Scanner :: batch_live (unsigned long long * out)
+{
+    unsigned long n = cur - batch_start + 1;
+    unsigned long k = batch_start - 1 - first;
+    unsigned long step = (tf.t_struct.storage == ROW_STORAGE) ? 
+                         tf.t_struct.row_length : ROW_FLAG_LEN;
+    memset (out, 0, (n + 63) / 64 * sizeof (unsigned long long));
+    for (unsigned long j = 0; j < n; j++)
+    {
+        if (buf[(k + j) * step] != ROW_DELETED)
+        {
+            out[j / 64] |= 1ULL << (j % 64);
+        }
+    }
+}
+
 #endif
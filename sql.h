@@ -4,12 +4,23 @@
 #include "dbms.h"
 #include <algorithm>
 #include <cctype>
+#include <climits>
 #include <cstring>
 #include <iostream>
-#include <regex>
+#include <list>
+#include <map>
 #include <set>
 #include <string>
 #include <vector>
+// kernels for SSE4.2 and AVX2 are built for x86 processors by GCC,
+// they are used if the processor has such instructions, lanes of the
+// kernels are 64-bit, so long has to be of the same size; on other
+// processors the scalar kernels are used
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__)) && \
+    (__SIZEOF_LONG__ == 8)
+#include <immintrin.h>
+#define SIMD_X86
+#endif
 
 using namespace std;
 
@@ -36,6 +47,9 @@ public:
     ~ SQLException () {}
 };
 
+struct like_pattern;
+struct where_program;
+
 // Interpreter --- SQL-interpreter class
 class Interpreter
 {
@@ -46,8 +60,36 @@ private:
     void delete_sentence (string &);
     void create_sentence (string &);
     void drop_sentence (string &);
+    void show_sentence (string &);
+    void vacuum_sentence (string &);
+    void compress_sentence (string &);
+    void analyze_sentence (string &);
+    void index_sentence (string &);
     void field_description (string &);
     vector <unsigned long> where_clause (string &);
+    // records of the scanner for which the program gives not 0
+    void check_records (where_program &, Table :: Scanner &, 
+                        vector <unsigned long> &);
+    // parts of the condition "field REL constant", "field [NOT] IN"
+    // or "field LIKE pattern"
+    bool simple_condition (string, unsigned long &, string &, string &);
+    bool index_scan (unsigned long, string, string, vector <unsigned long> &);
+    // the condition as ranges of values of the LONG field
+    bool long_ranges (string, string, vector <pair <long, long> > &);
+    // texts of the TEXT field which satisfy the condition
+    bool text_values (string, string, set <string> &);
+    // zones of records which can't satisfy the condition
+    vector <bool> zone_filter (unsigned long, string, string);
+    // the condition is checked once for every value of the dictionary
+    // of the field, the result is true for codes which satisfy it
+    vector <bool> dict_like (unsigned long, like_pattern &);
+    vector <bool> dict_in (unsigned long);
+    vector <bool> dict_where (unsigned long, string);
+    bool long_index_scan (unsigned long, string, string, 
+                          vector <unsigned long> &);
+    bool text_index_scan (unsigned long, string, string, 
+                          vector <unsigned long> &);
+    bool like_index_scan (unsigned long, string, vector <unsigned long> &);
     Table bd_table;
 public:
     Interpreter (string &);
@@ -73,6 +115,234 @@ string read_word (string & str)
     return word;
 }
 
+// the pattern of LIKE: % is any text, _ is any character,
+// \ makes the next character ordinary
+enum like_kind
+{
+    ANY_l,          // "%", any text
+    EXACT_l,        // the text itself
+    PREFIX_l,       // "text%"
+    SUFFIX_l,       // "%text"
+    CONTAINS_l,     // "%text%"
+    AUTOMATON_l     // other patterns
+};
+
+// like_pattern --- the compiled pattern of LIKE
+struct like_pattern
+{
+    enum like_kind kind;
+    string text;    // the text of EXACT_l, PREFIX_l, SUFFIX_l, CONTAINS_l
+    // AUTOMATON_l: the state j means the first j characters of the pattern
+    // are matched, the states are kept by bits in words words; 
+    // masks[c * words + ...] has the bit j if the character j (from 1) of
+    // the pattern is c or _, loops has the bit j if % follows it
+    unsigned long words;
+    unsigned long last;     // the state of the whole pattern
+    vector <unsigned long long> masks;
+    vector <unsigned long long> loops;
+    vector <unsigned long long> states;     // the states while matching
+};
+
+namespace like
+{
+    void compile (string, like_pattern &);
+    bool match (like_pattern &, const char *, size_t);
+    // texts which every string matching the pattern contains
+    vector <string> fragments (string);
+    
+    void compile (string pattern, like_pattern & p)
+    {
+        // characters of the pattern, wild is true for _, 
+        // percent is true for ones with % before them
+        string chars;
+        vector <bool> wild;
+        vector <bool> percent;
+        bool before = false;
+        for (size_t i = 0; i < pattern.length(); i++)
+        {
+            char c = pattern[i];
+            if (c == '%')
+            {
+                before = true;
+                continue;
+            }
+            if ((c == '\\') && (i + 1 < pattern.length()))
+            {
+                c = pattern[++i];
+                wild.push_back (false);
+            }
+            else
+            {
+                wild.push_back (c == '_');
+            }
+            chars += c;
+            percent.push_back (before);
+            before = false;
+        }
+        bool any_wild = (find (wild.begin(), wild.end(), true) != wild.end());
+        unsigned long inner = 0; // % between characters
+        for (unsigned long j = 1; j < percent.size(); j++)
+        {
+            inner += percent[j];
+        }
+        bool head = !percent.empty() && percent[0];
+        p.text = chars;
+        if (chars.empty())
+        {
+            p.kind = before ? ANY_l : EXACT_l;
+            return;
+        }
+        if (!any_wild && (inner == 0))
+        {
+            if (!head && !before)
+            {
+                p.kind = EXACT_l;
+                return;
+            }
+            if (!head)
+            {
+                p.kind = PREFIX_l;
+                return;
+            }
+            p.kind = before ? CONTAINS_l : SUFFIX_l;
+            return;
+        }
+        p.kind = AUTOMATON_l;
+        unsigned long m = chars.length();
+        p.words = (m + 1 + 63) / 64;
+        p.last = m;
+        p.masks.assign (256 * p.words, 0);
+        p.loops.assign (p.words, 0);
+        p.states.assign (p.words, 0);
+        for (unsigned long j = 1; j <= m; j++)
+        {
+            unsigned long long bit = 1ULL << (j % 64);
+            if (wild[j - 1])
+            {
+                for (unsigned long c = 0; c < 256; c++)
+                {
+                    p.masks[c * p.words + j / 64] |= bit;
+                }
+            }
+            else
+            {
+                p.masks[(unsigned char) chars[j - 1] * p.words + j / 64] |= 
+                    bit;
+            }
+            // % after the character j is the loop of the state j
+            if (((j < m) && percent[j]) || ((j == m) && before))
+            {
+                p.loops[j / 64] |= bit;
+            }
+        }
+        if (head)
+        {
+            p.loops[0] |= 1;
+        }
+    }
+    
+    bool match (like_pattern & p, const char * s, size_t len)
+    {
+        const string & t = p.text;
+        size_t n = t.length();
+        switch (p.kind)
+        {
+            case ANY_l:
+                return true;
+                
+            case EXACT_l:
+                return (len == n) && (memcmp (s, t.data(), n) == 0);
+                
+            case PREFIX_l:
+                return (len >= n) && (memcmp (s, t.data(), n) == 0);
+                
+            case SUFFIX_l:
+                return (len >= n) && 
+                       (memcmp (s + len - n, t.data(), n) == 0);
+                
+            case CONTAINS_l:
+            {
+                // the first character is searched by memchr
+                const char * end = s + len;
+                const char * cur = s;
+                while ((size_t) (end - cur) >= n)
+                {
+                    cur = (const char *) memchr (cur, t[0], end - cur - n + 1);
+                    if (cur == NULL)
+                    {
+                        return false;
+                    }
+                    if (memcmp (cur + 1, t.data() + 1, n - 1) == 0)
+                    {
+                        return true;
+                    }
+                    cur++;
+                }
+                return false;
+            }
+            
+            case AUTOMATON_l:
+                break;
+        }
+        // all states go at once by shifts of bits,
+        // no variant is tried again
+        unsigned long words = p.words;
+        unsigned long long * st = &(p.states[0]);
+        const unsigned long long * loops = &(p.loops[0]);
+        memset (st, 0, words * sizeof (unsigned long long));
+        st[0] = 1;
+        for (size_t i = 0; i < len; i++)
+        {
+            const unsigned long long * mask = 
+                &(p.masks[(unsigned char) s[i] * words]);
+            unsigned long long carry = 0;
+            bool alive = false;
+            for (unsigned long w = 0; w < words; w++)
+            {
+                unsigned long long old = st[w];
+                st[w] = (((old << 1) | carry) & mask[w]) | (old & loops[w]);
+                carry = old >> 63;
+                alive = alive || (st[w] != 0);
+            }
+            if (!alive)
+            {
+                return false;
+            }
+        }
+        return (st[p.last / 64] >> (p.last % 64)) & 1;
+    }
+    
+    // runs of ordinary characters between % and _
+    vector <string> fragments (string pattern)
+    {
+        vector <string> parts;
+        string cur;
+        for (size_t i = 0; i < pattern.length(); i++)
+        {
+            char c = pattern[i];
+            if ((c == '%') || (c == '_'))
+            {
+                if (!cur.empty())
+                {
+                    parts.push_back (cur);
+                    cur.clear();
+                }
+                continue;
+            }
+            if ((c == '\\') && (i + 1 < pattern.length()))
+            {
+                c = pattern[++i];
+            }
+            cur += c;
+        }
+        if (!cur.empty())
+        {
+            parts.push_back (cur);
+        }
+        return parts;
+    }
+} // end of namespace like
+
 /*--------------------------------------------------------------------*/
 
 // lexical and syntactic parsers for long-expressions
@@ -1050,6 +1320,16 @@ namespace parser_where
             }
             s = s + ") "; 
             lexer_where::next (str, bd);
+            // long-expression in brackets can begin the relation
+            if (flag_expr && (lexer_where::cur_lex_type_w == REL_w))
+            {
+                flag_log = 1;
+                s = s + lexer_where::cur_lex_text_w;
+                s = s + " ";
+                lexer_where::next (str, bd);
+                s = s + W3 (str, bd);
+                flag_expr = 0; // end of processing long-expression
+            }
         }
         else if (lexer_where::cur_lex_type_w == NOT_w)
         {
@@ -1609,195 +1889,1949 @@ namespace parser_where
 
 /*--------------------------------------------------------------------*/
 
-/*---------------SQLException---------------*/
-SQLException :: SQLException (sql_exception_code errcode)
+// the where-clause checked by the parser is compiled once into the tree,
+// names of fields are replaced by their numbers, so records are checked
+// without strings
+enum node_type
 {
-    switch (errcode) {
-        case ESE_COMAND:
-            err_message = "ERROR: wrong comand";
-            break;
-        case ESE_FIELDNAME:
-            err_message = "ERROR: wrong field name";
-            break;
-        case ESE_FIELD:
-            err_message = "ERROR: wrong field description";
-            break;
-        case ESE_TEXT:
-            err_message = "ERROR: wrong text format";
-            break;
-        case ESE_NUM:
-            err_message = "ERROR: wrong number format";
-            break;
-        case ESE_LONGEXPR:
-            err_message = "ERROR: wrong long-expression";
-            break;
-        case ESE_TEXTEXPR:
-            err_message = "ERROR: wrong text-expression";
-            break;
-        case ESE_WHERE:
-            err_message = "ERROR: wrong where-expression";
-            break;
-        case ESE_LOGEXPR:
-            err_message = "ERROR: wrong logic-expression";
-            break;
-        case ESE_STR:
-            err_message = "ERROR: not ended string";
-            break;
-    }
-}
+    NUMBER_n,   // constant of long-expression
+    LONG_n,     // value of the field with the type LONG
+    TEXT_n,     // value of the field with the type TEXT
+    STR_n,      // line
+    ARITH_n,    // +, -, *, /, % of two long-expressions
+    REL_n,      // =, >, <, !=, >=, <= of long- or text-expressions
+    AND_n,
+    OR_n,
+    NOT_n,
+    IN_n        // value of long-expression in the list of constants
+};
 
-void SQLException :: report ()
+enum rel_type
 {
-    std :: cout << err_message << std :: endl;
-}
+    EQ_r,
+    NE_r,
+    LT_r,
+    GT_r,
+    LE_r,
+    GE_r
+};
 
+// where_node --- one node of the compiled where-clause
+struct where_node
+{
+    enum node_type type;
+    char op;               // ARITH_n
+    enum rel_type rel;     // REL_n
+    long num;              // NUMBER_n
+    string text;           // STR_n
+    unsigned long field;   // LONG_n and TEXT_n
+    unsigned long len;     // TEXT_n, the length of the field
+    const vector <string> * values; // TEXT_n, the dictionary or NULL
+    long left;             // numbers of nodes of operands, -1 - none
+    long right;
+};
 
-/*---------------Interpreter---------------*/
-Interpreter :: Interpreter (string & str)
+// where_tree --- the compiled where-clause
+struct where_tree
 {
-    string cur_word;
-    cur_word = read_word (str); // operation
-    if (cur_word == "SELECT")
-    {
-        select_sentence (str);
-    }
-    else if (cur_word == "INSERT")
-    {
-        insert_sentence (str);
-    }
-    else if (cur_word == "UPDATE")
-    {
-        update_sensence (str);
-    }
-    else if (cur_word == "DELETE")
-    {
-        delete_sentence (str);
-    }
-    else if (cur_word == "CREATE")
-    {
-        create_sentence (str);
-    }
-    else if (cur_word == "DROP")
-    {
-        drop_sentence (str);
-    }
-    else
-    {
-        throw SQLException (SQLException :: ESE_COMAND);
-    }
-}
+    vector <where_node> nodes;
+    long root;
+    vector <long> list; // sorted constants of IN_n
+};
 
-void Interpreter :: select_sentence (string & str)
+namespace where_compiler
 {
-    vector <string> vect;
-    string cur_word;
-    cur_word = read_word (str); // first field_name
-    int fields_flag = 0;
-    if (cur_word == "*")
+    vector <string> words; // words of the where-clause, lines are whole
+    unsigned long pos;     // the current word
+    
+    void init (string, Table &);
+    string cur ();
+    long add (where_tree &, enum node_type, long, long);
+    // functions for compiling, the number of the node is returned
+    long or_expr (where_tree &, Table &);
+    long and_expr (where_tree &, Table &);
+    long not_expr (where_tree &, Table &);
+    long relation (where_tree &, Table &);
+    bool operator_word (string); // arithmetic or comparison
+    long long_expr (where_tree &, Table &);
+    long term (where_tree &, Table &);
+    long factor (where_tree &, Table &);
+    long text_operand (where_tree &, Table &);
+    // logic-expression and "long-expression [NOT] IN"
+    void compile_log (string, Table &, where_tree &);
+    void compile_in (string, Table &, const multiset <long> &, 
+                     where_tree &);
+    // long-expression of "UPDATE ... SET <field> = <expr>"
+    void compile_expr (string, Table &, where_tree &);
+    
+    void init (string s, Table & bd)
     {
-        // all fields
-        fields_flag = 1;
-        cur_word.clear();
-        cur_word = read_word (str);
+        words.clear();
+        pos = 0;
+        while (!s.empty())
+        {
+            string w = read_word (s);
+            // the line is joined back from its words
+            if (!w.empty() && (w[0] == '\''))
+            {
+                while ((w.length() < 2 || w[w.length() - 1] != '\'') && 
+                       (w != "'") && !s.empty())
+                {
+                    w = w + " " + read_word (s);
+                }
+            }
+            if (!w.empty())
+            {
+                words.push_back (w);
+            }
+        }
     }
-    else // {, field_name}
+    
+    string cur ()
     {
-        vect.push_back (cur_word);
-        cur_word.clear();
-        cur_word = read_word (str);
-        while (cur_word == ",")
+        if (pos < words.size())
         {
-            cur_word.clear();
-            cur_word = read_word (str); // next field_name
-            vect.push_back (cur_word);
-            cur_word.clear();
-            cur_word = read_word (str); // "," or not
+            return words[pos];
         }
+        return "";
     }
-    if (cur_word != "FROM")
+    
+    long add (where_tree & tree, enum node_type type, long left, long right)
     {
-        throw SQLException (SQLException :: ESE_COMAND);
+        where_node node;
+        node.type = type;
+        node.op = 0;
+        node.rel = EQ_r;
+        node.num = 0;
+        node.field = 0;
+        node.len = 0;
+        node.values = NULL;
+        node.left = left;
+        node.right = right;
+        tree.nodes.push_back (node);
+        return tree.nodes.size() - 1;
     }
-    cur_word.clear();
-    cur_word = read_word (str); // table_name
-    bd_table.open_table (cur_word);
-    cur_word.clear();
-    cur_word = read_word (str);
-    if (cur_word != "WHERE")
-    {
-        throw SQLException (SQLException :: ESE_COMAND);
-    } 
-    vector <unsigned long> v_where;
-    v_where = where_clause (str); // where-clause
-    // doing action for SELECT
-    if (fields_flag)
+    
+    long or_expr (where_tree & tree, Table & bd)
     {
-        bd_table.print_line_names ();
-        for (unsigned long i = 0; i < v_where.size(); i++)
+        long node = and_expr (tree, bd);
+        while (cur () == "OR")
         {
-            bd_table.print_line (v_where[i]);
+            pos++;
+            node = add (tree, OR_n, node, and_expr (tree, bd));
         }
+        return node;
     }
-    else
+    
+    long and_expr (where_tree & tree, Table & bd)
     {
-        bd_table.print_short_line_names (vect);
-        for (unsigned long i = 0; i < v_where.size(); i++)
+        long node = not_expr (tree, bd);
+        while (cur () == "AND")
         {
-            bd_table.print_short_line (vect, v_where[i]);
+            pos++;
+            node = add (tree, AND_n, node, not_expr (tree, bd));
         }
+        return node;
     }
     
-}
-
-void Interpreter :: insert_sentence (string & str)
-{
-    string cur_word;
-    cur_word = read_word (str); 
-    if (cur_word != "INTO")
-    {
-        throw SQLException (SQLException :: ESE_COMAND);
-    }
-    string table_name;
-    table_name = read_word (str);
-    bd_table.open_table (table_name); // open necessary table
-    cur_word.clear();
-    cur_word = read_word (str);
-    if (cur_word != "(")
+    long not_expr (where_tree & tree, Table & bd)
     {
-        throw SQLException (SQLException :: ESE_COMAND);
-    }
-    for (unsigned long i = 0; i < bd_table.t_struct.num_of_fields; i++)
-    {
-        // if the field with type TEXT
-        if (bd_table.fields[i].type == TEXT)
+        if (cur () == "NOT")
         {
-            string t_str;
-            if (cur_word.empty())
-            {
-                throw SQLException (SQLException::ESE_STR);
-            }
-            while (cur_word[cur_word.length() - 1] != '\'')
+            pos++;
+            return add (tree, NOT_n, not_expr (tree, bd), -1);
+        }
+        // brackets of logic-expression or of the long-expression which
+        // begins the relation, the second is tried if the first fails
+        // or the brackets are followed by an operator
+        if (cur () == "(")
+        {
+            unsigned long start = pos;
+            unsigned long count = tree.nodes.size();
+            try
             {
-                cur_word.clear();
-                cur_word = read_word (str);
-                if (cur_word.empty())
+                pos++;
+                long node = or_expr (tree, bd);
+                if (cur () == ")")
                 {
-                    throw SQLException (SQLException::ESE_STR);
+                    pos++;
+                    if (!operator_word (cur ()))
+                    {
+                        return node;
+                    }
                 }
-                t_str = t_str + cur_word;
-                t_str = t_str + ' ';
-            }
-            if (t_str[0] != '\'')
-            {
-                throw SQLException (SQLException :: ESE_TEXT);
             }
-            t_str.erase(0, 1);
-            t_str.erase((t_str.length() - 2), 2);
-            if (t_str.length() > bd_table.fields[i].field_len)
+            catch (SQLException &)
             {
-                throw TableException (TableException :: ESE_FIELDLEN);
+                // the brackets are parsed again by the relation
             }
-            strcpy (bd_table.fields[i].text, t_str.c_str());
+            pos = start;
+            tree.nodes.resize (count);
+        }
+        return relation (tree, bd);
+    }
+    
+    bool operator_word (string w)
+    {
+        return (w == "+") || (w == "-") || (w == "*") || (w == "/") || 
+               (w == "%") || (w == "=") || (w == "!=") || (w == "<") || 
+               (w == ">") || (w == "<=") || (w == ">=");
+    }
+    
+    long relation (where_tree & tree, Table & bd)
+    {
+        string w = cur ();
+        bool text = !w.empty() && ((w[0] == '\'') || 
+                    (!isdigit (w[0]) && (w != "(") && 
+                     (bd.get_field (w.c_str()) -> type == TEXT)));
+        long left = text ? text_operand (tree, bd) : long_expr (tree, bd);
+        string op = cur ();
+        enum rel_type rel;
+        if (op == "=")
+        {
+            rel = EQ_r;
+        }
+        else if (op == "!=")
+        {
+            rel = NE_r;
+        }
+        else if (op == "<")
+        {
+            rel = LT_r;
+        }
+        else if (op == ">")
+        {
+            rel = GT_r;
+        }
+        else if (op == "<=")
+        {
+            rel = LE_r;
+        }
+        else if (op == ">=")
+        {
+            rel = GE_r;
+        }
+        else
+        {
+            throw SQLException (SQLException :: ESE_LOGEXPR);
+        }
+        pos++;
+        long right = text ? text_operand (tree, bd) : long_expr (tree, bd);
+        long node = add (tree, REL_n, left, right);
+        tree.nodes[node].rel = rel;
+        return node;
+    }
+    
+    long long_expr (where_tree & tree, Table & bd)
+    {
+        long node = term (tree, bd);
+        while ((cur () == "+") || (cur () == "-"))
+        {
+            char op = cur ()[0];
+            pos++;
+            node = add (tree, ARITH_n, node, term (tree, bd));
+            tree.nodes[node].op = op;
+        }
+        return node;
+    }
+    
+    long term (where_tree & tree, Table & bd)
+    {
+        long node = factor (tree, bd);
+        while ((cur () == "*") || (cur () == "/") || (cur () == "%"))
+        {
+            char op = cur ()[0];
+            pos++;
+            node = add (tree, ARITH_n, node, factor (tree, bd));
+            tree.nodes[node].op = op;
+        }
+        return node;
+    }
+    
+    long factor (where_tree & tree, Table & bd)
+    {
+        string w = cur ();
+        if (w == "(")
+        {
+            pos++;
+            long node = long_expr (tree, bd);
+            if (cur () != ")")
+            {
+                throw SQLException (SQLException :: ESE_LONGEXPR);
+            }
+            pos++;
+            return node;
+        }
+        if (w.empty() || (w[0] == '\''))
+        {
+            throw SQLException (SQLException :: ESE_LONGEXPR);
+        }
+        pos++;
+        if (isdigit (w[0]))
+        {
+            long node = add (tree, NUMBER_n, -1, -1);
+            try
+            {
+                // convert string to long
+                tree.nodes[node].num = stol (w);
+            }
+            catch (...)
+            {
+                throw SQLException (SQLException :: ESE_NUM);
+            }
+            return node;
+        }
+        field_struct * f = bd.get_field (w.c_str());
+        if (f -> type != LONG)
+        {
+            throw SQLException (SQLException :: ESE_LONGEXPR);
+        }
+        long node = add (tree, LONG_n, -1, -1);
+        tree.nodes[node].field = bd.get_field_num (w.c_str());
+        return node;
+    }
+    
+    long text_operand (where_tree & tree, Table & bd)
+    {
+        string w = cur ();
+        if (w.empty())
+        {
+            throw SQLException (SQLException :: ESE_TEXTEXPR);
+        }
+        pos++;
+        if (w[0] == '\'')
+        {
+            long node = add (tree, STR_n, -1, -1);
+            // without the apostrophes
+            if (w.length() >= 2)
+            {
+                tree.nodes[node].text = w.substr (1, w.length() - 2);
+            }
+            return node;
+        }
+        field_struct * f = bd.get_field (w.c_str());
+        if (f -> type != TEXT)
+        {
+            throw SQLException (SQLException :: ESE_TEXTEXPR);
+        }
+        long node = add (tree, TEXT_n, -1, -1);
+        unsigned long f_num = bd.get_field_num (w.c_str());
+        tree.nodes[node].field = f_num;
+        tree.nodes[node].len = f -> field_len;
+        if (bd.encoded (f_num))
+        {
+            tree.nodes[node].values = &(bd.dict_values (f_num));
+        }
+        return node;
+    }
+    
+    void compile_log (string s, Table & bd, where_tree & tree)
+    {
+        init (s, bd);
+        tree.nodes.clear();
+        tree.root = or_expr (tree, bd);
+        if (pos != words.size())
+        {
+            throw SQLException (SQLException :: ESE_WHERE);
+        }
+    }
+    
+    void compile_in (string s, Table & bd, const multiset <long> & consts, 
+                     where_tree & tree)
+    {
+        init (s, bd);
+        tree.nodes.clear();
+        tree.list.assign (consts.begin(), consts.end());
+        long node = long_expr (tree, bd);
+        bool negative = (cur () == "NOT");
+        if (negative)
+        {
+            pos++;
+        }
+        if (cur () != "IN")
+        {
+            throw SQLException (SQLException :: ESE_WHERE);
+        }
+        pos++;
+        tree.root = add (tree, IN_n, node, -1);
+        if (negative)
+        {
+            tree.root = add (tree, NOT_n, tree.root, -1);
+        }
+    }
+    
+    void compile_expr (string s, Table & bd, where_tree & tree)
+    {
+        init (s, bd);
+        tree.nodes.clear();
+        tree.root = long_expr (tree, bd);
+        if (pos != words.size())
+        {
+            throw SQLException (SQLException :: ESE_LONGEXPR);
+        }
+    }
+} // end of namespace where_compiler
+
+/*--------------------------------------------------------------------*/
+
+// the tree of the where-clause is translated into the code of the stack
+// machine, which is run for every record
+enum op_code
+{
+    PUSH_op,        // the constant
+    FIELD_op,       // the value of the LONG field
+    LOAD_op,        // the value of the common subexpression
+    STORE_op,       // the value is moved from the stack to its slot
+    ADD_op,
+    SUB_op,
+    MUL_op,
+    DIV_op,
+    MOD_op,
+    REL_op,         // comparison of two values from the stack
+    TEXT_op,        // comparison of two texts given in the instruction
+    NOT_op,
+    IN_op,          // the value is replaced by 1 if it is in the list
+    JUMP_FALSE_op,  // AND: 0 is left as the result, else it is popped
+    JUMP_TRUE_op    // OR: not 0 is left as the result, else it is popped
+};
+
+// text_arg --- a text operand: the line or the TEXT field
+struct text_arg
+{
+    long str;              // number of the line, -1 - the field
+    unsigned long field;
+    unsigned long len;     // the length of the field
+    const vector <string> * values; // the dictionary of the field or NULL
+};
+
+// instruction --- one instruction of the stack machine
+struct instruction
+{
+    enum op_code op;
+    enum rel_type rel;     // REL_op and TEXT_op
+    long arg;              // the constant, the field, the slot or the jump
+    text_arg a;            // TEXT_op
+    text_arg b;
+};
+
+// where_program --- the compiled where-clause or long-expression
+struct where_program
+{
+    vector <instruction> code;
+    vector <long> list;    // sorted constants of IN_op
+    vector <string> lines; // lines of TEXT_op
+    vector <long> stack;   // the stack of the needed depth
+    vector <long> slots;   // values of common subexpressions
+};
+
+namespace where_vm
+{
+    // common subexpressions and their slots
+    map <string, unsigned long> uses;
+    map <string, long> slot_of;
+    long depth;            // the current depth of the stack while compiling
+    
+    long fold (where_tree &, long);
+    bool safe (const where_tree &, long);
+    string key (const where_tree &, long);
+    void count (const where_tree &, long);
+    void hoist (where_tree &, long, where_program &);
+    void emit (where_tree &, long, where_program &);
+    void emit_op (where_tree &, long, where_program &);
+    void put (where_program &, enum op_code, long, long);
+    text_arg text_operand (const where_tree &, long, where_program &);
+    void compile (where_tree &, where_program &);
+    void text_of (const where_program &, const text_arg &, 
+                  Table :: Scanner &, const char * &, size_t &);
+    long run (where_program &, Table :: Scanner &);
+    
+    // constant folding: the node becomes NUMBER_n when its value doesn't
+    // depend on records, errors of division are left for running
+    long fold (where_tree & tree, long n)
+    {
+        where_node & node = tree.nodes[n];
+        if ((node.left < 0) || (node.type == NUMBER_n))
+        {
+            return n;
+        }
+        where_node & l = tree.nodes[fold (tree, node.left)];
+        if (node.right >= 0)
+        {
+            fold (tree, node.right);
+        }
+        switch (node.type)
+        {
+            case ARITH_n:
+            {
+                where_node & r = tree.nodes[node.right];
+                if ((l.type != NUMBER_n) || (r.type != NUMBER_n))
+                {
+                    break;
+                }
+                long a = l.num;
+                long b = r.num;
+                if ((node.op == '/') || (node.op == '%'))
+                {
+                    if ((b == 0) || ((a == LONG_MIN) && (b == -1)))
+                    {
+                        break;
+                    }
+                    node.num = (node.op == '/') ? a / b : a % b;
+                }
+                else if (node.op == '+')
+                {
+                    node.num = a + b;
+                }
+                else if (node.op == '-')
+                {
+                    node.num = a - b;
+                }
+                else
+                {
+                    node.num = a * b;
+                }
+                node.type = NUMBER_n;
+                break;
+            }
+            
+            case REL_n:
+            {
+                where_node & r = tree.nodes[node.right];
+                int cmp;
+                if ((l.type == NUMBER_n) && (r.type == NUMBER_n))
+                {
+                    cmp = (l.num < r.num) ? -1 : (l.num > r.num);
+                }
+                else if ((l.type == STR_n) && (r.type == STR_n))
+                {
+                    cmp = l.text.compare (r.text);
+                }
+                else
+                {
+                    break;
+                }
+                switch (node.rel)
+                {
+                    case EQ_r:
+                        node.num = (cmp == 0);
+                        break;
+                    case NE_r:
+                        node.num = (cmp != 0);
+                        break;
+                    case LT_r:
+                        node.num = (cmp < 0);
+                        break;
+                    case GT_r:
+                        node.num = (cmp > 0);
+                        break;
+                    case LE_r:
+                        node.num = (cmp <= 0);
+                        break;
+                    case GE_r:
+                        node.num = (cmp >= 0);
+                        break;
+                }
+                node.type = NUMBER_n;
+                break;
+            }
+            
+            case AND_n:
+            case OR_n:
+            {
+                // operands of AND and OR are always 0 or 1
+                bool is_and = (node.type == AND_n);
+                where_node & r = tree.nodes[node.right];
+                if (l.type == NUMBER_n)
+                {
+                    if ((l.num != 0) != is_and)
+                    {
+                        node.num = !is_and;
+                        node.type = NUMBER_n;
+                    }
+                    else
+                    {
+                        node = r;
+                    }
+                }
+                // the left operand is kept, its errors must be reported
+                else if ((r.type == NUMBER_n) && ((r.num != 0) == is_and))
+                {
+                    node = l;
+                }
+                break;
+            }
+            
+            case NOT_n:
+                if (l.type == NUMBER_n)
+                {
+                    node.num = !l.num;
+                    node.type = NUMBER_n;
+                }
+                break;
+                
+            case IN_n:
+                if (l.type == NUMBER_n)
+                {
+                    node.num = binary_search (tree.list.begin(), 
+                                              tree.list.end(), l.num);
+                    node.type = NUMBER_n;
+                }
+                break;
+                
+            default:
+                break;
+        }
+        return n;
+    }
+    
+    // the arithmetic can't fail, so it can be calculated before
+    // the checking of the record begins
+    bool safe (const where_tree & tree, long n)
+    {
+        const where_node & node = tree.nodes[n];
+        if ((node.type == NUMBER_n) || (node.type == LONG_n))
+        {
+            return true;
+        }
+        if (node.type != ARITH_n)
+        {
+            return false;
+        }
+        if ((node.op == '/') || (node.op == '%'))
+        {
+            const where_node & r = tree.nodes[node.right];
+            if ((r.type != NUMBER_n) || (r.num == 0) || (r.num == -1))
+            {
+                return false;
+            }
+        }
+        return safe (tree, node.left) && safe (tree, node.right);
+    }
+    
+    // equal long-expressions have equal keys
+    string key (const where_tree & tree, long n)
+    {
+        const where_node & node = tree.nodes[n];
+        if (node.type == NUMBER_n)
+        {
+            return to_string (node.num);
+        }
+        if (node.type == LONG_n)
+        {
+            return "#" + to_string (node.field);
+        }
+        return "(" + key (tree, node.left) + " " + node.op + " " + 
+               key (tree, node.right) + ")";
+    }
+    
+    void count (const where_tree & tree, long n)
+    {
+        const where_node & node = tree.nodes[n];
+        if ((node.type == ARITH_n) && safe (tree, n))
+        {
+            uses[key (tree, n)]++;
+        }
+        if (node.left >= 0)
+        {
+            count (tree, node.left);
+        }
+        if (node.right >= 0)
+        {
+            count (tree, node.right);
+        }
+    }
+    
+    // subexpressions used more than once are calculated first,
+    // inner ones before outer ones
+    void hoist (where_tree & tree, long n, where_program & prog)
+    {
+        const where_node & node = tree.nodes[n];
+        if (node.left >= 0)
+        {
+            hoist (tree, node.left, prog);
+        }
+        if (node.right >= 0)
+        {
+            hoist (tree, node.right, prog);
+        }
+        if ((node.type != ARITH_n) || !safe (tree, n))
+        {
+            return;
+        }
+        string k = key (tree, n);
+        if ((uses[k] < 2) || slot_of.count (k))
+        {
+            return;
+        }
+        emit_op (tree, n, prog);
+        slot_of[k] = prog.slots.size();
+        put (prog, STORE_op, prog.slots.size(), -1);
+        prog.slots.push_back (0);
+    }
+    
+    void put (where_program & prog, enum op_code op, long arg, long change)
+    {
+        instruction ins;
+        ins.op = op;
+        ins.rel = EQ_r;
+        ins.arg = arg;
+        prog.code.push_back (ins);
+        depth += change;
+        if (depth > (long) prog.stack.size())
+        {
+            prog.stack.resize (depth);
+        }
+    }
+    
+    void emit (where_tree & tree, long n, where_program & prog)
+    {
+        const where_node & node = tree.nodes[n];
+        if (node.type == ARITH_n)
+        {
+            map <string, long> :: iterator it = slot_of.find (key (tree, n));
+            if (it != slot_of.end())
+            {
+                put (prog, LOAD_op, it -> second, 1);
+                return;
+            }
+        }
+        emit_op (tree, n, prog);
+    }
+    
+    void emit_op (where_tree & tree, long n, where_program & prog)
+    {
+        const where_node & node = tree.nodes[n];
+        switch (node.type)
+        {
+            case NUMBER_n:
+                put (prog, PUSH_op, node.num, 1);
+                break;
+                
+            case LONG_n:
+                put (prog, FIELD_op, node.field, 1);
+                break;
+                
+            case ARITH_n:
+                emit (tree, node.left, prog);
+                emit (tree, node.right, prog);
+                if (node.op == '+')
+                {
+                    put (prog, ADD_op, 0, -1);
+                }
+                else if (node.op == '-')
+                {
+                    put (prog, SUB_op, 0, -1);
+                }
+                else if (node.op == '*')
+                {
+                    put (prog, MUL_op, 0, -1);
+                }
+                else if (node.op == '/')
+                {
+                    put (prog, DIV_op, 0, -1);
+                }
+                else
+                {
+                    put (prog, MOD_op, 0, -1);
+                }
+                break;
+                
+            case REL_n:
+                if ((tree.nodes[node.left].type == STR_n) || 
+                    (tree.nodes[node.left].type == TEXT_n))
+                {
+                    text_arg a = text_operand (tree, node.left, prog);
+                    text_arg b = text_operand (tree, node.right, prog);
+                    put (prog, TEXT_op, 0, 1);
+                    prog.code.back().a = a;
+                    prog.code.back().b = b;
+                }
+                else
+                {
+                    emit (tree, node.left, prog);
+                    emit (tree, node.right, prog);
+                    put (prog, REL_op, 0, -1);
+                }
+                prog.code.back().rel = node.rel;
+                break;
+                
+            case AND_n:
+            case OR_n:
+            {
+                // the right operand is skipped when the left one gives
+                // the result
+                emit (tree, node.left, prog);
+                unsigned long jump = prog.code.size();
+                put (prog, (node.type == AND_n) ? JUMP_FALSE_op : 
+                     JUMP_TRUE_op, 0, -1);
+                emit (tree, node.right, prog);
+                prog.code[jump].arg = prog.code.size();
+                break;
+            }
+            
+            case NOT_n:
+                emit (tree, node.left, prog);
+                put (prog, NOT_op, 0, 0);
+                break;
+                
+            case IN_n:
+                emit (tree, node.left, prog);
+                put (prog, IN_op, 0, 0);
+                break;
+                
+            default:
+                throw SQLException (SQLException :: ESE_WHERE);
+        }
+    }
+    
+    text_arg text_operand (const where_tree & tree, long n, 
+                           where_program & prog)
+    {
+        const where_node & node = tree.nodes[n];
+        text_arg arg;
+        arg.str = -1;
+        arg.field = node.field;
+        arg.len = node.len;
+        arg.values = node.values;
+        if (node.type == STR_n)
+        {
+            arg.str = prog.lines.size();
+            prog.lines.push_back (node.text);
+        }
+        return arg;
+    }
+    
+    void compile (where_tree & tree, where_program & prog)
+    {
+        prog.code.clear();
+        prog.lines.clear();
+        prog.stack.clear();
+        prog.slots.clear();
+        prog.list = tree.list;
+        uses.clear();
+        slot_of.clear();
+        depth = 0;
+        fold (tree, tree.root);
+        count (tree, tree.root);
+        hoist (tree, tree.root, prog);
+        emit (tree, tree.root, prog);
+    }
+    
+    // texts of fields are compared in the record without copying
+    void text_of (const where_program & prog, const text_arg & arg, 
+                  Table :: Scanner & sc, const char * & text, size_t & len)
+    {
+        if (arg.str >= 0)
+        {
+            text = prog.lines[arg.str].data();
+            len = prog.lines[arg.str].length();
+        }
+        else if (arg.values != NULL)
+        {
+            const string & value = (*arg.values)[sc.code (arg.field)];
+            text = value.data();
+            len = value.length();
+        }
+        else
+        {
+            text = sc.value (arg.field);
+            len = strnlen (text, arg.len);
+        }
+    }
+    
+    // the value of the program for the current record of the scanner
+    long run (where_program & prog, Table :: Scanner & sc)
+    {
+        long * st = &(prog.stack[0]) - 1; // the top of the stack
+        const instruction * code = &(prog.code[0]);
+        unsigned long size = prog.code.size();
+        unsigned long pc = 0;
+        while (pc < size)
+        {
+            const instruction & ins = code[pc++];
+            switch (ins.op)
+            {
+                case PUSH_op:
+                    *++st = ins.arg;
+                    break;
+                    
+                case FIELD_op:
+                    *++st = sc.get_long (ins.arg);
+                    break;
+                    
+                case LOAD_op:
+                    *++st = prog.slots[ins.arg];
+                    break;
+                    
+                case STORE_op:
+                    prog.slots[ins.arg] = *st--;
+                    break;
+                    
+                case ADD_op:
+                    st--;
+                    st[0] += st[1];
+                    break;
+                    
+                case SUB_op:
+                    st--;
+                    st[0] -= st[1];
+                    break;
+                    
+                case MUL_op:
+                    st--;
+                    st[0] *= st[1];
+                    break;
+                    
+                case DIV_op:
+                case MOD_op:
+                    st--;
+                    // the division which can't be done
+                    if ((st[1] == 0) || ((st[0] == LONG_MIN) && (st[1] == -1)))
+                    {
+                        throw SQLException (SQLException :: ESE_LONGEXPR);
+                    }
+                    st[0] = (ins.op == DIV_op) ? st[0] / st[1] : 
+                                                 st[0] % st[1];
+                    break;
+                    
+                case REL_op:
+                case TEXT_op:
+                {
+                    int cmp;
+                    if (ins.op == REL_op)
+                    {
+                        st--;
+                        cmp = (st[0] < st[1]) ? -1 : (st[0] > st[1]);
+                    }
+                    else
+                    {
+                        const char * a;
+                        const char * b;
+                        size_t a_len;
+                        size_t b_len;
+                        text_of (prog, ins.a, sc, a, a_len);
+                        text_of (prog, ins.b, sc, b, b_len);
+                        cmp = memcmp (a, b, min (a_len, b_len));
+                        if (cmp == 0)
+                        {
+                            cmp = (a_len < b_len) ? -1 : (a_len > b_len);
+                        }
+                        st++;
+                    }
+                    switch (ins.rel)
+                    {
+                        case EQ_r:
+                            *st = (cmp == 0);
+                            break;
+                        case NE_r:
+                            *st = (cmp != 0);
+                            break;
+                        case LT_r:
+                            *st = (cmp < 0);
+                            break;
+                        case GT_r:
+                            *st = (cmp > 0);
+                            break;
+                        case LE_r:
+                            *st = (cmp <= 0);
+                            break;
+                        case GE_r:
+                            *st = (cmp >= 0);
+                            break;
+                    }
+                    break;
+                }
+                
+                case NOT_op:
+                    *st = !*st;
+                    break;
+                    
+                case IN_op:
+                    *st = binary_search (prog.list.begin(), prog.list.end(), 
+                                         *st);
+                    break;
+                    
+                case JUMP_FALSE_op:
+                    if (*st == 0)
+                    {
+                        pc = ins.arg;
+                    }
+                    else
+                    {
+                        st--;
+                    }
+                    break;
+                    
+                case JUMP_TRUE_op:
+                    if (*st != 0)
+                    {
+                        pc = ins.arg;
+                    }
+                    else
+                    {
+                        st--;
+                    }
+                    break;
+            }
+        }
+        return *st;
+    }
+} // end of namespace where_vm
+
+/*--------------------------------------------------------------------*/
+
+// kernels of the checking by columns: comparisons and arithmetic
+// of BATCH_LINES values, the code for SSE4.2 or AVX2 is chosen by
+// the processor, the scalar code is used on other processors
+namespace kernels
+{
+    // the first operand is a, the second one is b or the constant c,
+    // if b is NULL
+    typedef void (* compare_t) (const long *, const long *, long, 
+                                enum rel_type, unsigned long, 
+                                unsigned long long *);
+    typedef void (* arith_t) (char, const long *, const long *, long, 
+                              unsigned long, long *);
+    
+    void compare_scalar (const long *, const long *, long, enum rel_type, 
+                         unsigned long, unsigned long long *);
+    void arith_scalar (char, const long *, const long *, long, 
+                       unsigned long, long *);
+#ifdef SIMD_X86
+    void compare_sse42 (const long *, const long *, long, enum rel_type, 
+                        unsigned long, unsigned long long *);
+    void arith_sse42 (char, const long *, const long *, long, 
+                      unsigned long, long *);
+    void compare_avx2 (const long *, const long *, long, enum rel_type, 
+                       unsigned long, unsigned long long *);
+    void arith_avx2 (char, const long *, const long *, long, 
+                     unsigned long, long *);
+#endif
+    
+    compare_t compare = NULL;
+    arith_t arith = NULL;
+    void choose ();
+    
+    void choose ()
+    {
+        compare = compare_scalar;
+        arith = arith_scalar;
+#ifdef SIMD_X86
+        __builtin_cpu_init ();
+        if (__builtin_cpu_supports ("avx2"))
+        {
+            compare = compare_avx2;
+            arith = arith_avx2;
+        }
+        else if (__builtin_cpu_supports ("sse4.2"))
+        {
+            compare = compare_sse42;
+            arith = arith_sse42;
+        }
+#endif
+    }
+    
+    // the result for the pair of values
+    inline bool rel (long x, long y, enum rel_type r)
+    {
+        switch (r)
+        {
+            case EQ_r:
+                return x == y;
+            case NE_r:
+                return x != y;
+            case LT_r:
+                return x < y;
+            case GT_r:
+                return x > y;
+            case LE_r:
+                return x <= y;
+            case GE_r:
+                return x >= y;
+        }
+        return false;
+    }
+    
+    inline long apply (char op, long x, long y)
+    {
+        if (op == '+')
+        {
+            return x + y;
+        }
+        if (op == '-')
+        {
+            return x - y;
+        }
+        if (op == '*')
+        {
+            return x * y;
+        }
+        // the divisor is checked before
+        return (op == '/') ? x / y : x % y;
+    }
+    
+    void compare_scalar (const long * a, const long * b, long c, 
+                         enum rel_type r, unsigned long n, 
+                         unsigned long long * bits)
+    {
+        memset (bits, 0, (n + 63) / 64 * sizeof (unsigned long long));
+        for (unsigned long k = 0; k < n; k++)
+        {
+            if (rel (a[k], b ? b[k] : c, r))
+            {
+                bits[k / 64] |= 1ULL << (k % 64);
+            }
+        }
+    }
+    
+    void arith_scalar (char op, const long * a, const long * b, long c, 
+                       unsigned long n, long * out)
+    {
+        for (unsigned long k = 0; k < n; k++)
+        {
+            out[k] = apply (op, a[k], b ? b[k] : c);
+        }
+    }
+    
+#ifdef SIMD_X86
+    // the comparison is made by > or by =, the operands are swapped
+    // for <, >= and the bits are inverted for !=, <=, >=
+    __attribute__ ((target ("sse4.2")))
+    void compare_sse42 (const long * a, const long * b, long c, 
+                        enum rel_type r, unsigned long n, 
+                        unsigned long long * bits)
+    {
+        bool eq = (r == EQ_r) || (r == NE_r);
+        bool swap = (r == LT_r) || (r == GE_r);
+        int inv = ((r == NE_r) || (r == LE_r) || (r == GE_r)) ? 0x3 : 0;
+        __m128i cv = _mm_set1_epi64x (c);
+        unsigned long k = 0;
+        memset (bits, 0, (n + 63) / 64 * sizeof (unsigned long long));
+        for (; k + 2 <= n; k += 2)
+        {
+            __m128i x = _mm_loadu_si128 ((const __m128i *) (a + k));
+            __m128i y = b ? _mm_loadu_si128 ((const __m128i *) (b + k)) : cv;
+            __m128i m;
+            if (eq)
+            {
+                m = _mm_cmpeq_epi64 (x, y);
+            }
+            else
+            {
+                m = swap ? _mm_cmpgt_epi64 (y, x) : _mm_cmpgt_epi64 (x, y);
+            }
+            unsigned long long v = _mm_movemask_pd (_mm_castsi128_pd (m)) ^ 
+                                   inv;
+            bits[k / 64] |= v << (k % 64);
+        }
+        for (; k < n; k++)
+        {
+            if (rel (a[k], b ? b[k] : c, r))
+            {
+                bits[k / 64] |= 1ULL << (k % 64);
+            }
+        }
+    }
+    
+    // + and - by vectors, there is no multiplication of 64-bit values
+    // before AVX-512, so * and others are scalar
+    __attribute__ ((target ("sse4.2")))
+    void arith_sse42 (char op, const long * a, const long * b, long c, 
+                      unsigned long n, long * out)
+    {
+        if ((op != '+') && (op != '-'))
+        {
+            arith_scalar (op, a, b, c, n, out);
+            return;
+        }
+        __m128i cv = _mm_set1_epi64x (c);
+        unsigned long k = 0;
+        for (; k + 2 <= n; k += 2)
+        {
+            __m128i x = _mm_loadu_si128 ((const __m128i *) (a + k));
+            __m128i y = b ? _mm_loadu_si128 ((const __m128i *) (b + k)) : cv;
+            _mm_storeu_si128 ((__m128i *) (out + k), (op == '+') ? 
+                              _mm_add_epi64 (x, y) : _mm_sub_epi64 (x, y));
+        }
+        for (; k < n; k++)
+        {
+            out[k] = apply (op, a[k], b ? b[k] : c);
+        }
+    }
+    
+    __attribute__ ((target ("avx2")))
+    void compare_avx2 (const long * a, const long * b, long c, 
+                       enum rel_type r, unsigned long n, 
+                       unsigned long long * bits)
+    {
+        bool eq = (r == EQ_r) || (r == NE_r);
+        bool swap = (r == LT_r) || (r == GE_r);
+        int inv = ((r == NE_r) || (r == LE_r) || (r == GE_r)) ? 0xf : 0;
+        __m256i cv = _mm256_set1_epi64x (c);
+        unsigned long k = 0;
+        memset (bits, 0, (n + 63) / 64 * sizeof (unsigned long long));
+        for (; k + 4 <= n; k += 4)
+        {
+            __m256i x = _mm256_loadu_si256 ((const __m256i *) (a + k));
+            __m256i y = b ? _mm256_loadu_si256 ((const __m256i *) (b + k)) : 
+                            cv;
+            __m256i m;
+            if (eq)
+            {
+                m = _mm256_cmpeq_epi64 (x, y);
+            }
+            else
+            {
+                m = swap ? _mm256_cmpgt_epi64 (y, x) : 
+                           _mm256_cmpgt_epi64 (x, y);
+            }
+            unsigned long long v = 
+                _mm256_movemask_pd (_mm256_castsi256_pd (m)) ^ inv;
+            bits[k / 64] |= v << (k % 64);
+        }
+        for (; k < n; k++)
+        {
+            if (rel (a[k], b ? b[k] : c, r))
+            {
+                bits[k / 64] |= 1ULL << (k % 64);
+            }
+        }
+    }
+    
+    __attribute__ ((target ("avx2")))
+    void arith_avx2 (char op, const long * a, const long * b, long c, 
+                     unsigned long n, long * out)
+    {
+        if ((op != '+') && (op != '-'))
+        {
+            arith_scalar (op, a, b, c, n, out);
+            return;
+        }
+        __m256i cv = _mm256_set1_epi64x (c);
+        unsigned long k = 0;
+        for (; k + 4 <= n; k += 4)
+        {
+            __m256i x = _mm256_loadu_si256 ((const __m256i *) (a + k));
+            __m256i y = b ? _mm256_loadu_si256 ((const __m256i *) (b + k)) : 
+                            cv;
+            _mm256_storeu_si256 ((__m256i *) (out + k), (op == '+') ? 
+                                 _mm256_add_epi64 (x, y) : 
+                                 _mm256_sub_epi64 (x, y));
+        }
+        for (; k < n; k++)
+        {
+            out[k] = apply (op, a[k], b ? b[k] : c);
+        }
+    }
+#endif
+} // end of namespace kernels
+
+/*--------------------------------------------------------------------*/
+
+// the program of the where-clause is run for the batch of records
+// at once: every instruction is done for all values of the batch,
+// conditions give bits of records
+enum batch_kind
+{
+    CONST_b,    // the same value for all records
+    LONGS_b,    // values of records
+    BITS_b      // bits of records for which the condition is true
+};
+
+// batch_value --- a value of the stack for the batch of records
+struct batch_value
+{
+    enum batch_kind kind;
+    long num;
+    vector <long> longs;
+    vector <unsigned long long> bits;
+};
+
+namespace where_batch
+{
+    vector <batch_value> stack;
+    vector <batch_value> slots;
+    vector <unsigned long long> live;
+    // the ends of the right operands of AND and OR not yet joined
+    vector <unsigned long> ends;
+    vector <bool> ands;
+    
+    bool fits (const where_program &);
+    void to_bits (batch_value &, unsigned long);
+    void binary (const instruction &, batch_value &, batch_value &, 
+                 unsigned long);
+    void join (batch_value &, batch_value &, bool, unsigned long);
+    void run (where_program &, Table :: Scanner &, 
+              vector <unsigned long> &);
+    void run_batch (where_program &, Table :: Scanner &, unsigned long);
+    
+    // the division is done by columns only by constants, other
+    // divisors can be zero for records where the condition doesn't
+    // come to them, so such programs are run for every record
+    bool fits (const where_program & prog)
+    {
+        for (unsigned long pc = 0; pc < prog.code.size(); pc++)
+        {
+            const instruction & ins = prog.code[pc];
+            if ((ins.op == DIV_op) || (ins.op == MOD_op))
+            {
+                if ((pc == 0) || (prog.code[pc - 1].op != PUSH_op) || 
+                    (prog.code[pc - 1].arg == 0) || 
+                    (prog.code[pc - 1].arg == -1))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    
+    void to_bits (batch_value & v, unsigned long n)
+    {
+        unsigned long words = (n + 63) / 64;
+        if (v.kind == CONST_b)
+        {
+            for (unsigned long w = 0; w < words; w++)
+            {
+                v.bits[w] = v.num ? ~0ULL : 0;
+            }
+        }
+        else if (v.kind == LONGS_b)
+        {
+            kernels :: compare (&(v.longs[0]), NULL, 0, NE_r, n, 
+                                &(v.bits[0]));
+        }
+        v.kind = BITS_b;
+    }
+    
+    // x = x op y for arithmetic and comparison
+    void binary (const instruction & ins, batch_value & x, batch_value & y, 
+                 unsigned long n)
+    {
+        char op = 0;
+        switch (ins.op)
+        {
+            case ADD_op:
+                op = '+';
+                break;
+            case SUB_op:
+                op = '-';
+                break;
+            case MUL_op:
+                op = '*';
+                break;
+            case DIV_op:
+                op = '/';
+                break;
+            case MOD_op:
+                op = '%';
+                break;
+            default:
+                break;
+        }
+        if ((x.kind == CONST_b) && (y.kind == CONST_b))
+        {
+            x.num = op ? kernels :: apply (op, x.num, y.num) : 
+                         kernels :: rel (x.num, y.num, ins.rel);
+            return;
+        }
+        const long * b = (y.kind == CONST_b) ? NULL : &(y.longs[0]);
+        if (x.kind == CONST_b)
+        {
+            // the constant is spread to the column
+            for (unsigned long k = 0; k < n; k++)
+            {
+                x.longs[k] = x.num;
+            }
+        }
+        if (op)
+        {
+            kernels :: arith (op, &(x.longs[0]), b, y.num, n, 
+                              &(x.longs[0]));
+            x.kind = LONGS_b;
+        }
+        else
+        {
+            kernels :: compare (&(x.longs[0]), b, y.num, ins.rel, n, 
+                                &(x.bits[0]));
+            x.kind = BITS_b;
+        }
+    }
+    
+    void join (batch_value & x, batch_value & y, bool is_and, 
+               unsigned long n)
+    {
+        to_bits (x, n);
+        to_bits (y, n);
+        for (unsigned long w = 0; w < (n + 63) / 64; w++)
+        {
+            x.bits[w] = is_and ? (x.bits[w] & y.bits[w]) : 
+                                 (x.bits[w] | y.bits[w]);
+        }
+    }
+    
+    void run_batch (where_program & prog, Table :: Scanner & sc, 
+                    unsigned long n)
+    {
+        long sp = -1;
+        unsigned long first = sc.batch_first ();
+        for (unsigned long pc = 0; pc <= prog.code.size(); pc++)
+        {
+            // AND and OR get both operands at the end of the right one
+            while (!ends.empty() && (ends.back() == pc))
+            {
+                join (stack[sp - 1], stack[sp], ands.back(), n);
+                sp--;
+                ends.pop_back();
+                ands.pop_back();
+            }
+            if (pc == prog.code.size())
+            {
+                break;
+            }
+            const instruction & ins = prog.code[pc];
+            switch (ins.op)
+            {
+                case PUSH_op:
+                    sp++;
+                    stack[sp].kind = CONST_b;
+                    stack[sp].num = ins.arg;
+                    break;
+                    
+                case FIELD_op:
+                    sp++;
+                    stack[sp].kind = LONGS_b;
+                    sc.batch_longs (ins.arg, &(stack[sp].longs[0]));
+                    break;
+                    
+                case LOAD_op:
+                    sp++;
+                    stack[sp].kind = slots[ins.arg].kind;
+                    stack[sp].num = slots[ins.arg].num;
+                    stack[sp].longs = slots[ins.arg].longs;
+                    break;
+                    
+                case STORE_op:
+                    swap (slots[ins.arg], stack[sp]);
+                    sp--;
+                    break;
+                    
+                case ADD_op:
+                case SUB_op:
+                case MUL_op:
+                case DIV_op:
+                case MOD_op:
+                case REL_op:
+                    binary (ins, stack[sp - 1], stack[sp], n);
+                    sp--;
+                    break;
+                    
+                case TEXT_op:
+                {
+                    // texts are compared by records of the batch
+                    sp++;
+                    batch_value & v = stack[sp];
+                    v.kind = BITS_b;
+                    memset (&(v.bits[0]), 0, 
+                            (n + 63) / 64 * sizeof (unsigned long long));
+                    for (unsigned long k = 0; k < n; k++)
+                    {
+                        sc.go (first + k);
+                        const char * a;
+                        const char * b;
+                        size_t a_len;
+                        size_t b_len;
+                        where_vm :: text_of (prog, ins.a, sc, a, a_len);
+                        where_vm :: text_of (prog, ins.b, sc, b, b_len);
+                        int cmp = memcmp (a, b, min (a_len, b_len));
+                        if (cmp == 0)
+                        {
+                            cmp = (a_len < b_len) ? -1 : (a_len > b_len);
+                        }
+                        if (kernels :: rel (cmp, 0, ins.rel))
+                        {
+                            v.bits[k / 64] |= 1ULL << (k % 64);
+                        }
+                    }
+                    sc.go (first + n - 1);
+                    break;
+                }
+                
+                case NOT_op:
+                    to_bits (stack[sp], n);
+                    for (unsigned long w = 0; w < (n + 63) / 64; w++)
+                    {
+                        stack[sp].bits[w] = ~stack[sp].bits[w];
+                    }
+                    break;
+                    
+                case IN_op:
+                {
+                    batch_value & v = stack[sp];
+                    if (v.kind == CONST_b)
+                    {
+                        v.num = binary_search (prog.list.begin(), 
+                                               prog.list.end(), v.num);
+                        break;
+                    }
+                    memset (&(v.bits[0]), 0, 
+                            (n + 63) / 64 * sizeof (unsigned long long));
+                    for (unsigned long k = 0; k < n; k++)
+                    {
+                        if (binary_search (prog.list.begin(), 
+                                           prog.list.end(), v.longs[k]))
+                        {
+                            v.bits[k / 64] |= 1ULL << (k % 64);
+                        }
+                    }
+                    v.kind = BITS_b;
+                    break;
+                }
+                
+                case JUMP_FALSE_op:
+                case JUMP_TRUE_op:
+                    // both operands are calculated for all records
+                    ends.push_back (ins.arg);
+                    ands.push_back (ins.op == JUMP_FALSE_op);
+                    break;
+            }
+        }
+        to_bits (stack[0], n);
+    }
+    
+    // records of the where-clause are added to the list
+    void run (where_program & prog, Table :: Scanner & sc, 
+              vector <unsigned long> & vect)
+    {
+        if (kernels :: compare == NULL)
+        {
+            kernels :: choose ();
+        }
+        // the left operand of AND and OR stays on the stack while
+        // the right one is calculated
+        unsigned long depth = prog.stack.size();
+        for (unsigned long pc = 0; pc < prog.code.size(); pc++)
+        {
+            if ((prog.code[pc].op == JUMP_FALSE_op) || 
+                (prog.code[pc].op == JUMP_TRUE_op))
+            {
+                depth++;
+            }
+        }
+        stack.resize (depth);
+        slots.resize (prog.slots.size());
+        for (unsigned long i = 0; i < stack.size(); i++)
+        {
+            stack[i].longs.resize (BATCH_LINES);
+            stack[i].bits.resize (BATCH_LINES / 64);
+        }
+        for (unsigned long i = 0; i < slots.size(); i++)
+        {
+            slots[i].longs.resize (BATCH_LINES);
+            slots[i].bits.resize (BATCH_LINES / 64);
+        }
+        live.resize (BATCH_LINES / 64);
+        ends.clear();
+        ands.clear();
+        unsigned long n;
+        while ((n = sc.next_batch ()) != 0)
+        {
+            run_batch (prog, sc, n);
+            sc.batch_live (&(live[0]));
+            unsigned long first = sc.batch_first ();
+            for (unsigned long w = 0; w < (n + 63) / 64; w++)
+            {
+                unsigned long long bits = stack[0].bits[w] & live[w];
+                // numbers of records by the set bits
+                while (bits != 0)
+                {
+                    vect.push_back (first + w * 64 + 
+                                    __builtin_ctzll (bits));
+                    bits &= bits - 1;
+                }
+            }
+        }
+    }
+} // end of namespace where_batch
+
+/*--------------------------------------------------------------------*/
+
+// compiled LIKE patterns and programs of where-clauses are kept for
+// next statements by their normalized texts; programs are kept with
+// the table name and the description of its fields, so a table created
+// again with other fields gets new programs
+namespace query_cache
+{
+    list <string> pattern_lru; // the first is the last used
+    map <string, pair <like_pattern, list <string> :: iterator> > patterns;
+    list <string> program_lru;
+    map <string, pair <where_program, list <string> :: iterator> > programs;
+    
+    // the cached item is moved to the beginning of the list
+    template <class T>
+    T * find (map <string, pair <T, list <string> :: iterator> > &, 
+              list <string> &, string);
+    // the new item, the last used one is removed if there is no room
+    template <class T>
+    T & add (map <string, pair <T, list <string> :: iterator> > &, 
+             list <string> &, unsigned long, string, T &);
+    like_pattern & pattern (string); // compiled pattern of LIKE
+    string program_key (string, string, Table &);
+    where_program * find_program (string, Table &);
+    where_program & add_program (string, where_program &);
+    void bind (where_program &, Table &);
+    
+    template <class T>
+    T * find (map <string, pair <T, list <string> :: iterator> > & items, 
+              list <string> & lru, string key)
+    {
+        typename map <string, pair <T, list <string> :: iterator> > :: 
+            iterator it = items.find (key);
+        if (it == items.end())
+        {
+            io_stats :: cur.cache_misses++;
+            return NULL;
+        }
+        io_stats :: cur.cache_hits++;
+        lru.splice (lru.begin(), lru, it -> second.second);
+        return &(it -> second.first);
+    }
+    
+    template <class T>
+    T & add (map <string, pair <T, list <string> :: iterator> > & items, 
+             list <string> & lru, unsigned long capacity, string key, 
+             T & item)
+    {
+        if (items.size() >= capacity)
+        {
+            items.erase (lru.back());
+            lru.pop_back();
+            io_stats :: cur.cache_evictions++;
+        }
+        lru.push_front (key);
+        pair <T, list <string> :: iterator> & place = items[key];
+        swap (place.first, item);
+        place.second = lru.begin();
+        return place.first;
+    }
+    
+    like_pattern & pattern (string text)
+    {
+        like_pattern * p = find (patterns, pattern_lru, text);
+        if (p != NULL)
+        {
+            return *p;
+        }
+        like_pattern compiled;
+        like :: compile (text, compiled);
+        return add (patterns, pattern_lru, CACHE_PATTERNS, text, compiled);
+    }
+    
+    // the kind of the program, the table with its fields and the text
+    string program_key (string kind, string text, Table & bd)
+    {
+        string key = kind + " " + bd.t_struct.table_name + " (";
+        for (unsigned long i = 0; i < bd.t_struct.num_of_fields; i++)
+        {
+            key += string (" ") + bd.fields[i].name + " " + 
+                   to_string (bd.fields[i].type) + " " + 
+                   to_string (bd.fields[i].field_len) + 
+                   (bd.encoded (i) ? " D" : "");
+        }
+        return key + " ) " + text;
+    }
+    
+    where_program * find_program (string key, Table & bd)
+    {
+        where_program * prog = find (programs, program_lru, key);
+        if (prog != NULL)
+        {
+            bind (*prog, bd);
+        }
+        return prog;
+    }
+    
+    where_program & add_program (string key, where_program & prog)
+    {
+        return add (programs, program_lru, CACHE_PROGRAMS, key, prog);
+    }
+    
+    // dictionaries of fields belong to the opened table
+    void bind (where_program & prog, Table & bd)
+    {
+        for (unsigned long pc = 0; pc < prog.code.size(); pc++)
+        {
+            instruction & ins = prog.code[pc];
+            if (ins.op != TEXT_op)
+            {
+                continue;
+            }
+            if (ins.a.str < 0)
+            {
+                ins.a.values = bd.encoded (ins.a.field) ? 
+                               &(bd.dict_values (ins.a.field)) : NULL;
+            }
+            if (ins.b.str < 0)
+            {
+                ins.b.values = bd.encoded (ins.b.field) ? 
+                               &(bd.dict_values (ins.b.field)) : NULL;
+            }
+        }
+    }
+} // end of namespace query_cache
+
+/*--------------------------------------------------------------------*/
+
+/*---------------SQLException---------------*/
+SQLException :: SQLException (sql_exception_code errcode)
+{
+    switch (errcode) {
+        case ESE_COMAND:
+            err_message = "ERROR: wrong comand";
+            break;
+        case ESE_FIELDNAME:
+            err_message = "ERROR: wrong field name";
+            break;
+        case ESE_FIELD:
+            err_message = "ERROR: wrong field description";
+            break;
+        case ESE_TEXT:
+            err_message = "ERROR: wrong text format";
+            break;
+        case ESE_NUM:
+            err_message = "ERROR: wrong number format";
+            break;
+        case ESE_LONGEXPR:
+            err_message = "ERROR: wrong long-expression";
+            break;
+        case ESE_TEXTEXPR:
+            err_message = "ERROR: wrong text-expression";
+            break;
+        case ESE_WHERE:
+            err_message = "ERROR: wrong where-expression";
+            break;
+        case ESE_LOGEXPR:
+            err_message = "ERROR: wrong logic-expression";
+            break;
+        case ESE_STR:
+            err_message = "ERROR: not ended string";
+            break;
+    }
+}
+
+void SQLException :: report ()
+{
+    std :: cout << err_message << std :: endl;
+}
+
+
+/*---------------Interpreter---------------*/
+Interpreter :: Interpreter (string & str)
+{
+    string cur_word;
+    cur_word = read_word (str); // operation
+    // statements and checkpoints of the log work one by one
+    unique_lock <mutex> lock (wal :: db_lock);
+    // statistics are shown for the previous statement
+    if (cur_word != "SHOW")
+    {
+        io_stats :: start_statement ();
+    }
+    wal :: begin ();
+    try
+    {
+        if (cur_word == "SELECT")
+        {
+            select_sentence (str);
+        }
+        else if (cur_word == "INSERT")
+        {
+            insert_sentence (str);
+        }
+        else if (cur_word == "UPDATE")
+        {
+            update_sensence (str);
+        }
+        else if (cur_word == "DELETE")
+        {
+            delete_sentence (str);
+        }
+        else if (cur_word == "CREATE")
+        {
+            create_sentence (str);
+        }
+        else if (cur_word == "DROP")
+        {
+            drop_sentence (str);
+        }
+        else if (cur_word == "SHOW")
+        {
+            show_sentence (str);
+        }
+        else if (cur_word == "VACUUM")
+        {
+            vacuum_sentence (str);
+        }
+        else if (cur_word == "COMPRESS")
+        {
+            compress_sentence (str);
+        }
+        else if (cur_word == "ANALYZE")
+        {
+            analyze_sentence (str);
+        }
+        else
+        {
+            throw SQLException (SQLException :: ESE_COMAND);
+        }
+    }
+    catch (...)
+    {
+        // with the log the changes made before the error are rolled back,
+        // without it they are kept
+        if (!wal :: enabled)
+        {
+            table_files :: flush_all ();
+        }
+        wal :: rollback ();
+        throw;
+    }
+    // without the log changed data of all tables is written at the end
+    // of the statement, records of INSERT wait in the tails for the next
+    // statements; with the log the tables are written by checkpoints
+    if (!wal :: enabled && (cur_word != "INSERT"))
+    {
+        table_files :: flush_all ();
+    }
+    unsigned long lsn = wal :: commit ();
+    // the statement which drops files waits for the commit with the lock
+    table_files :: remove_dropped (lsn);
+    // other statements can work while the log is synced,
+    // their commits are synced together with this one
+    lock.unlock ();
+    wal :: wait (lsn);
+}
+
+void Interpreter :: select_sentence (string & str)
+{
+    vector <string> vect;
+    string cur_word;
+    cur_word = read_word (str); // first field_name
+    int fields_flag = 0;
+    if (cur_word == "*")
+    {
+        // all fields
+        fields_flag = 1;
+        cur_word.clear();
+        cur_word = read_word (str);
+    }
+    else // {, field_name}
+    {
+        vect.push_back (cur_word);
+        cur_word.clear();
+        cur_word = read_word (str);
+        while (cur_word == ",")
+        {
+            cur_word.clear();
+            cur_word = read_word (str); // next field_name
+            vect.push_back (cur_word);
+            cur_word.clear();
+            cur_word = read_word (str); // "," or not
+        }
+    }
+    if (cur_word != "FROM")
+    {
+        throw SQLException (SQLException :: ESE_COMAND);
+    }
+    cur_word.clear();
+    cur_word = read_word (str); // table_name
+    bd_table.open_table (cur_word);
+    cur_word.clear();
+    cur_word = read_word (str);
+    if (cur_word != "WHERE")
+    {
+        throw SQLException (SQLException :: ESE_COMAND);
+    } 
+    vector <unsigned long> v_where;
+    v_where = where_clause (str); // where-clause
+    // doing action for SELECT
+    if (fields_flag)
+    {
+        bd_table.print_line_names ();
+        Table :: Scanner sc (bd_table);
+        for (unsigned long i = 0; i < v_where.size(); i++)
+        {
+            sc.go (v_where[i]);
+            sc.read ();
+            bd_table.print_fields ();
+        }
+    }
+    else
+    {
+        bd_table.print_short_line_names (vect);
+        // only selected fields are read
+        bd_table.use_fields (vect);
+        Table :: Scanner sc (bd_table);
+        for (unsigned long i = 0; i < v_where.size(); i++)
+        {
+            sc.go (v_where[i]);
+            sc.read ();
+            bd_table.print_short_fields (vect);
+        }
+        bd_table.use_all_fields ();
+    }
+    
+}
+
+void Interpreter :: insert_sentence (string & str)
+{
+    string cur_word;
+    cur_word = read_word (str); 
+    if (cur_word != "INTO")
+    {
+        throw SQLException (SQLException :: ESE_COMAND);
+    }
+    string table_name;
+    table_name = read_word (str);
+    bd_table.open_table (table_name); // open necessary table
+    cur_word.clear();
+    cur_word = read_word (str);
+    if (cur_word != "(")
+    {
+        throw SQLException (SQLException :: ESE_COMAND);
+    }
+    for (unsigned long i = 0; i < bd_table.t_struct.num_of_fields; i++)
+    {
+        // if the field with type TEXT
+        if (bd_table.fields[i].type == TEXT)
+        {
+            string t_str;
+            if (cur_word.empty())
+            {
+                throw SQLException (SQLException::ESE_STR);
+            }
+            while (cur_word[cur_word.length() - 1] != '\'')
+            {
+                cur_word.clear();
+                cur_word = read_word (str);
+                if (cur_word.empty())
+                {
+                    throw SQLException (SQLException::ESE_STR);
+                }
+                t_str = t_str + cur_word;
+                t_str = t_str + ' ';
+            }
+            if (t_str[0] != '\'')
+            {
+                throw SQLException (SQLException :: ESE_TEXT);
+            }
+            t_str.erase(0, 1);
+            t_str.erase((t_str.length() - 2), 2);
+            if (t_str.length() > bd_table.fields[i].field_len)
+            {
+                throw TableException (TableException :: ESE_FIELDLEN);
+            }
+            strcpy (bd_table.fields[i].text, t_str.c_str());
         }
         // if the field with type LONG
         else
@@ -1921,10 +3955,32 @@ void Interpreter :: update_sensence (string & str)
     }
     vector <unsigned long> v_where;
     v_where = where_clause (str); // where-clause
-    // doing actions for UPDATE
+    // the long-expression is compiled once for the same expression
+    where_tree tree;
+    where_program compiled;
+    where_program * prog = NULL;
+    if (f -> type == LONG)
+    {
+        string key = query_cache :: program_key ("SET", expr_num, bd_table);
+        prog = query_cache :: find_program (key, bd_table);
+        if (prog == NULL)
+        {
+            where_compiler :: compile_expr (expr_num, bd_table, tree);
+            where_vm :: compile (tree, compiled);
+            prog = &(query_cache :: add_program (key, compiled));
+        }
+    }
+    // doing actions for UPDATE,
+    // the records go in ascending order, so the scanner reads every block once
+    if (!v_where.empty())
+    {
+        bd_table.prepare_change ();
+    }
+    Table :: Scanner sc (bd_table);
     for (unsigned long i = 0; i < v_where.size(); i++)
     {
-        bd_table.read_line(v_where[i]);
+        sc.go (v_where[i]);
+        sc.read ();
         if (f -> type == TEXT)
         {
             if (!expr_text.empty())
@@ -1939,9 +3995,7 @@ void Interpreter :: update_sensence (string & str)
         }
         else
         {
-            string tmp = expr_num + "WHERE";
-            parser_long_expr::init (tmp);
-            f -> l_num = parser_long_expr::A (tmp, bd_table);
+            f -> l_num = where_vm :: run (*prog, sc);
         }
         bd_table.update_line (v_where[i]);
     }
@@ -1968,10 +4022,12 @@ void Interpreter :: delete_sentence (string & str)
     vector <unsigned long> v_where;
     v_where = where_clause (str); // where-clause
     // doing actions for DELETE
-    for (unsigned long i = v_where.size(); i > 0; i--)
+    // the records are only marked, the file is compacted
+    // when there are too many deleted records
+    bd_table.delete_lines (v_where);
+    if (bd_table.need_vacuum ())
     {
-        bd_table.read_line (v_where[i-1]);
-        bd_table.delete_line ();
+        bd_table.vacuum ();
     }
     bd_table.print_table ();
 }
@@ -1980,6 +4036,11 @@ void Interpreter :: create_sentence (string & str)
 {
     string cur_word;
     cur_word = read_word (str);
+    if (cur_word == "INDEX")
+    {
+        index_sentence (str);
+        return;
+    }
     if (cur_word != "TABLE")
     {
         throw SQLException (SQLException :: ESE_COMAND);
@@ -2006,8 +4067,28 @@ void Interpreter :: create_sentence (string & str)
         throw SQLException (SQLException :: ESE_COMAND);
     }
     cur_word.clear();
-    // check if it is the end of the comand
     cur_word = read_word (str);
+    // placement of the records in the file
+    if (cur_word == "STORAGE")
+    {
+        cur_word.clear();
+        cur_word = read_word (str);
+        if (cur_word == "COLUMNAR")
+        {
+            bd_table.t_struct.storage = COLUMN_STORAGE;
+        }
+        else if (cur_word == "ROW")
+        {
+            bd_table.t_struct.storage = ROW_STORAGE;
+        }
+        else
+        {
+            throw SQLException (SQLException :: ESE_COMAND);
+        }
+        cur_word.clear();
+        cur_word = read_word (str);
+    }
+    // check if it is the end of the comand
     if (!cur_word.empty())
     {
         throw SQLException (SQLException :: ESE_COMAND);
@@ -2022,21 +4103,263 @@ void Interpreter :: drop_sentence (string & str)
     string cur_word;
     string t_name;
     cur_word = read_word (str);
-    if (cur_word != "TABLE")
+    if (cur_word != "TABLE")
+    {
+        throw SQLException (SQLException :: ESE_COMAND);
+    }
+    t_name = read_word (str); // table_name
+    cur_word.clear();
+    // check if it is the end of the comand
+    cur_word = read_word (str);
+    if (!cur_word.empty())
+    {
+        throw SQLException (SQLException :: ESE_COMAND);
+    }
+    // doing actions for DELETE
+    bd_table.delete_table (t_name);
+    cout << "The table " << t_name << " was deleted" << endl;
+}
+
+void Interpreter :: show_sentence (string & str)
+{
+    string cur_word;
+    string what;
+    what = read_word (str);
+    if ((what != "STATS") && (what != "TABLES"))
+    {
+        throw SQLException (SQLException :: ESE_COMAND);
+    }
+    // check if it is the end of the comand
+    cur_word = read_word (str);
+    if (!cur_word.empty())
+    {
+        throw SQLException (SQLException :: ESE_COMAND);
+    }
+    // doing actions for SHOW
+    if (what == "STATS")
+    {
+        io_stats :: print ();
+        return;
+    }
+    // the tables are listed from the catalog without opening their files
+    catalog :: load ();
+    map <string, catalog_table> :: iterator it;
+    for (it = catalog :: tables.begin(); it != catalog :: tables.end(); it++)
+    {
+        catalog_entry & entry = it -> second.entry;
+        cout << entry.table_name << " (" << entry.file_name << ", ";
+        if (entry.storage == COMPRESSED_STORAGE)
+        {
+            cout << "COMPRESSED";
+        }
+        else
+        {
+            cout << ((entry.storage == COLUMN_STORAGE) ? "COLUMNAR" : "ROWS");
+        }
+        cout << "):";
+        for (unsigned long i = 0; i < it -> second.fields.size(); i++)
+        {
+            field_struct & f = it -> second.fields[i];
+            cout << ((i == 0) ? " " : " , ") << f.name;
+            if (f.type == LONG)
+            {
+                cout << " LONG";
+                continue;
+            }
+            cout << " TEXT ( " << f.field_len << " )";
+            if (f.l_num == DICT_CODE_LEN)
+            {
+                cout << " DICTIONARY";
+            }
+        }
+        cout << endl;
+    }
+}
+
+void Interpreter :: vacuum_sentence (string & str)
+{
+    string cur_word;
+    string t_name;
+    t_name = read_word (str); // table_name
+    // check if it is the end of the comand
+    cur_word = read_word (str);
+    if (!cur_word.empty())
+    {
+        throw SQLException (SQLException :: ESE_COMAND);
+    }
+    // doing actions for VACUUM
+    bd_table.open_table (t_name);
+    unsigned long reclaimed;
+    unsigned long removed = bd_table.vacuum (reclaimed);
+    cout << "The table " << t_name << " was compacted, " << removed;
+    cout << " deleted records removed, " << reclaimed;
+    cout << " bytes reclaimed" << endl;
+}
+
+void Interpreter :: compress_sentence (string & str)
+{
+    string cur_word;
+    string t_name;
+    t_name = read_word (str); // table_name
+    // check if it is the end of the comand
+    cur_word = read_word (str);
+    if (!cur_word.empty())
+    {
+        throw SQLException (SQLException :: ESE_COMAND);
+    }
+    // doing actions for COMPRESS
+    bd_table.open_table (t_name);
+    unsigned long before;
+    unsigned long after;
+    if (!bd_table.compress (before, after))
+    {
+        cout << "The table " << t_name << " was not compressed, " << before;
+        cout << " bytes of data" << endl;
+        return;
+    }
+    cout << "The table " << t_name << " was compressed, " << after;
+    cout << " bytes of data instead of " << before << endl;
+}
+
+void Interpreter :: analyze_sentence (string & str)
+{
+    string cur_word;
+    string t_name;
+    t_name = read_word (str); // table_name
+    // check if it is the end of the comand
+    cur_word = read_word (str);
+    if (!cur_word.empty())
+    {
+        throw SQLException (SQLException :: ESE_COMAND);
+    }
+    // doing actions for ANALYZE
+    bd_table.open_table (t_name);
+    unsigned long read;
+    unsigned long zones;
+    bd_table.analyze (read, zones);
+    cout << "The statistics of " << t_name << " were made, " << read;
+    cout << " of " << zones << " zones read" << endl;
+    for (unsigned long i = 0; i < bd_table.t_struct.num_of_fields; i++)
+    {
+        column_stats col;
+        bd_table.get_stats (i, col);
+        cout << bd_table.fields[i].name << ": " << col.rows << " records, ";
+        cout << col.distinct << " distinct, " << col.non_null;
+        cout << " not empty";
+        if (col.rows == 0)
+        {
+            cout << endl;
+            continue;
+        }
+        if (bd_table.fields[i].type == LONG)
+        {
+            cout << ", from " << col.min << " to " << col.max << endl;
+            cout << "    histogram:";
+            for (unsigned long b = 0; b < col.num_bounds; b++)
+            {
+                cout << " " << col.bounds[b];
+            }
+            cout << endl;
+            continue;
+        }
+        cout << ", from '" << stats :: text (col.min_text) << "' to '";
+        cout << stats :: text (col.max_text) << "'" << endl;
+        cout << "    common:";
+        for (unsigned long k = 0; k < col.num_common; k++)
+        {
+            cout << " '" << stats :: text (col.common[k].text) << "' ";
+            cout << col.common[k].count;
+        }
+        cout << endl;
+    }
+}
+
+// CREATE INDEX index_name ON table_name ( field_name ) 
+// [USING BTREE|HASH|TRIGRAM]
+void Interpreter :: index_sentence (string & str)
+{
+    string cur_word;
+    string i_name;
+    string t_name;
+    string f_name;
+    i_name = read_word (str); // index_name
+    cur_word = read_word (str);
+    if (cur_word != "ON")
+    {
+        throw SQLException (SQLException :: ESE_COMAND);
+    }
+    t_name = read_word (str); // table_name
+    cur_word.clear();
+    cur_word = read_word (str);
+    if (cur_word != "(")
+    {
+        throw SQLException (SQLException :: ESE_COMAND);
+    }
+    f_name = read_word (str); // field_name
+    cur_word.clear();
+    cur_word = read_word (str);
+    if (cur_word != ")")
     {
         throw SQLException (SQLException :: ESE_COMAND);
     }
-    t_name = read_word (str); // table_name
     cur_word.clear();
-    // check if it is the end of the comand
     cur_word = read_word (str);
+    // the kind of the index
+    index_type type = BTREE_INDEX;
+    unsigned long bits = BLOOM_BITS;
+    if (cur_word == "USING")
+    {
+        cur_word.clear();
+        cur_word = read_word (str);
+        if (cur_word == "HASH")
+        {
+            type = HASH_INDEX;
+        }
+        else if (cur_word == "TRIGRAM")
+        {
+            type = TRIGRAM_INDEX;
+        }
+        else if (cur_word == "BLOOM")
+        {
+            type = BLOOM_INDEX;
+        }
+        else if (cur_word != "BTREE")
+        {
+            throw SQLException (SQLException :: ESE_COMAND);
+        }
+        cur_word.clear();
+        cur_word = read_word (str);
+        // bits of the filter of one zone
+        if ((type == BLOOM_INDEX) && (cur_word == "("))
+        {
+            cur_word.clear();
+            cur_word = read_word (str);
+            if (cur_word.empty() || (cur_word.length() > 9) || 
+                (cur_word.find_first_not_of ("0123456789") != 
+                 string :: npos))
+            {
+                throw SQLException (SQLException :: ESE_COMAND);
+            }
+            bits = stoul (cur_word);
+            cur_word.clear();
+            cur_word = read_word (str);
+            if (cur_word != ")")
+            {
+                throw SQLException (SQLException :: ESE_COMAND);
+            }
+            cur_word.clear();
+            cur_word = read_word (str);
+        }
+    }
+    // check if it is the end of the comand
     if (!cur_word.empty())
     {
         throw SQLException (SQLException :: ESE_COMAND);
     }
-    // doing actions for DELETE
-    bd_table.delete_table (t_name);
-    cout << "The table " << t_name << " was deleted" << endl;
+    // doing actions for CREATE INDEX
+    bd_table.open_table (t_name);
+    bd_table.create_index (i_name, f_name, type, bits);
+    cout << "The index " << i_name << " was created" << endl;
 }
 
 void Interpreter :: field_description (string & str)
@@ -2071,7 +4394,17 @@ void Interpreter :: field_description (string & str)
         {
             throw SQLException (SQLException :: ESE_FIELD);
         }
-        bd_table.add_text (f_name.c_str(), num);
+        // the word after the field is looked at without taking it
+        string rest = str;
+        if (read_word (rest) == "DICTIONARY")
+        {
+            str = rest;
+            bd_table.add_dict_text (f_name.c_str(), num);
+        }
+        else
+        {
+            bd_table.add_text (f_name.c_str(), num);
+        }
     }
     else if (f_type == "LONG")
     {
@@ -2088,98 +4421,121 @@ vector <unsigned long> Interpreter :: where_clause (string & str)
 {
     // doing actions for WHERE-clause
     vector <unsigned long> vect;
-    // analisys of WHERE-clause
+    // analisys of WHERE-clause, lists of constants of the previous
+    // statement are forgotten
+    parser_where::mst_l.clear();
+    parser_where::mst_s.clear();
+    parser_where::flag_log = 0;
+    parser_where::flag_expr = 0;
     parser_where :: init (str, bd_table);
     string s = parser_where :: W0 (str, bd_table);
     if (lexer_where::cur_lex_type_w != END_w)
     {
         throw SQLException (SQLException :: ESE_WHERE);
     }
+    // the index replaces the full scan for simple conditions
+    unsigned long c_num;
+    string c_op;
+    string c_value;
+    bool simple = simple_condition (s, c_num, c_op, c_value);
+    if (simple && index_scan (c_num, c_op, c_value, vect))
+    {
+        sort(vect.begin(), vect.end());
+        return vect;
+    }
+    // the scan passes by zones whose values can't satisfy the condition
+    vector <bool> skipped;
+    if (simple)
+    {
+        skipped = zone_filter (c_num, c_op, c_value);
+    }
     string f_name;
     string w;
     string s_log;
+    where_tree tree;
+    where_program compiled;
+    where_program * prog;
+    string key;
+    // only fields of the where-clause are read
+    vector <string> names;
+    s_log = s;
+    while (!s_log.empty())
+    {
+        names.push_back (read_word (s_log));
+    }
+    bd_table.use_fields (names);
+    Table :: Scanner sc (bd_table);
+    sc.skip_zones (skipped);
     // processing necesssary mode
     switch (parser_where::mode)
     {
         case LIKE_alt:
+        {
             f_name = read_word(s);
             w = read_word(s);
-            if (w == "NOT")
+            bool negative = (w == "NOT");
+            if (negative)
             {
                 w.clear();
                 w = read_word(s);
-                w.clear();
-                w = read_word(s);
-                w.pop_back();
-                w.erase(0, 1);
-                regex rx (w.c_str());
-                // filling in the list
-                // if NOT LIKE
-                for (unsigned long i = 0; i < 
-                     bd_table.t_struct.num_of_records; i++)
-                {
-                    bd_table.read_line (i+1);
-                    field_struct * f;
-                    f = bd_table.get_field (f_name.c_str());
-                    if (!regex_match (f -> text, rx))
-                    {
-                        vect.push_back (i + 1);
-                    }
-                }
             }
-            else if (w == "LIKE")
+            // the pattern without apostrophes
+            w.clear();
+            w = read_word(s);
+            while ((w.length() < 2 || w[w.length() - 1] != '\'') && 
+                   !s.empty())
             {
-                w.clear();
-                w = read_word(s);
-                w.pop_back();
-                w.erase(0, 1);
-                regex rx (w.c_str());
-                // filling in the list
-                // if LIKE
-                for (unsigned long i = 0; i < 
-                     bd_table.t_struct.num_of_records; i++)
-                {
-                    bd_table.read_line (i+1);
-                    field_struct * f;
-                    f = bd_table.get_field (f_name.c_str());
-                    if (regex_match (f -> text, rx))
-                    {
-                        vect.push_back (i + 1);
-                    }
-                }
+                w = w + " " + read_word (s);
             }
-            break;
-            
-        case IN_alt_L:
-            for (unsigned long i = 0; i < 
-                 bd_table.t_struct.num_of_records; i++)
-            {
-                string s_tmp = s;
-                bd_table.read_line (i+1);
-                long num;
-                // calculating the value of long-expression
-                parser_long_expr::init (s_tmp);
-                num = parser_long_expr::A (s_tmp, bd_table);
-                // filling in the list
-                // if IN
-                if (lexer_long_expr::c == "IN")
+            w.pop_back();
+            w.erase(0, 1);
+            like_pattern & pattern = query_cache :: pattern (w);
+            unsigned long f_num = bd_table.get_field_num (f_name.c_str());
+            unsigned long f_len = bd_table.fields[f_num].field_len;
+            bool dict = bd_table.encoded (f_num);
+            vector <bool> found = dict_like (f_num, pattern);
+            // filling in the list,
+            // texts are matched in the block of the scanner
+            while (sc.next ())
+            {
+                bool res;
+                if (dict)
                 {
-                    if (parser_where::mst_l.count(num))
-                    {
-                        vect.push_back (i + 1);
-                    }
+                    res = found[sc.code (f_num)];
                 }
-                // filling in the list
-                // if NOT IN
-                else if (lexer_long_expr::c == "NOT")
+                else
                 {
-                    if (!parser_where::mst_l.count(num))
-                    {
-                        vect.push_back (i + 1);
-                    }
+                    const char * text = sc.value (f_num);
+                    res = like :: match (pattern, text, 
+                                         strnlen (text, f_len));
+                }
+                if (res != negative)
+                {
+                    vect.push_back (sc.line_num ());
                 }
             }
             break;
+        }
+            
+        case IN_alt_L:
+            // the long-expression is compiled once for the same clause
+            key = s + "(";
+            for (multiset <long> :: iterator it = parser_where::mst_l.begin();
+                 it != parser_where::mst_l.end(); it++)
+            {
+                key += " " + to_string (*it);
+            }
+            key = query_cache :: program_key ("IN", key + " )", bd_table);
+            prog = query_cache :: find_program (key, bd_table);
+            if (prog == NULL)
+            {
+                where_compiler :: compile_in (s, bd_table, 
+                                              parser_where::mst_l, tree);
+                where_vm :: compile (tree, compiled);
+                prog = &(query_cache :: add_program (key, compiled));
+            }
+            check_records (*prog, sc, vect);
+            break;
             
         case IN_alt_T:
             // if text-expression is name of the field with type TEXT
@@ -2187,30 +4543,29 @@ vector <unsigned long> Interpreter :: where_clause (string & str)
             {
                 f_name = read_word(s);
                 w = read_word(s);
-                for (unsigned long i = 0; i < 
-                     bd_table.t_struct.num_of_records; i++)
+                unsigned long f_num = bd_table.get_field_num (f_name.c_str());
+                bool dict = bd_table.encoded (f_num);
+                vector <bool> found = dict_in (f_num);
+                while (sc.next ())
                 {
-                    bd_table.read_line (i+1);
-                    field_struct * f;
-                    f = bd_table.get_field (f_name.c_str());
+                    bool in = dict ? found[sc.code (f_num)] : 
+                              parser_where::mst_s.count(sc.get_text (f_num));
                     // filling in the list
                     // if IN
                     if (w == "IN")
                     {
-                        if (parser_where::mst_s.
-                            count(string(f -> text)))
+                        if (in)
                         {
-                            vect.push_back (i + 1);
+                            vect.push_back (sc.line_num ());
                         }
                     }
                     // filling in the list
                     // if NOT IN
                     else if (w == "NOT")
                     {
-                        if (!parser_where::mst_s.
-                            count(string(f -> text)))
+                        if (!in)
                         {
-                            vect.push_back (i + 1);
+                            vect.push_back (sc.line_num ());
                         }
                     }
                 }
@@ -2237,10 +4592,9 @@ vector <unsigned long> Interpreter :: where_clause (string & str)
                 {
                     if (parser_where::mst_s.count(t_str))
                     {
-                        for (unsigned long i = 0; i < 
-                             bd_table.t_struct.num_of_records; i++)
+                        while (sc.next ())
                         {
-                            vect.push_back (i + 1);
+                            vect.push_back (sc.line_num ());
                         }
                     }
                 }
@@ -2250,10 +4604,9 @@ vector <unsigned long> Interpreter :: where_clause (string & str)
                 {
                     if (!parser_where::mst_s.count(t_str))
                     {
-                        for (unsigned long i = 0; i < 
-                             bd_table.t_struct.num_of_records; i++)
+                        while (sc.next ())
                         {
-                            vect.push_back (i + 1);
+                            vect.push_back (sc.line_num ());
                         }
                     }
                 }
@@ -2261,35 +4614,435 @@ vector <unsigned long> Interpreter :: where_clause (string & str)
             break;
         
         case LOG_alt:
-            long num;
-            // filling in the list
-            for (unsigned long i = 0; i < 
-                 bd_table.t_struct.num_of_records; i++)
+            // the field with dictionary is compared with the string
+            // by codes of its values
+            if (simple && bd_table.encoded (c_num) && 
+                (c_value.length() >= 2) && (c_value[0] == '\'') && 
+                (c_value.find ('\'', 1) == c_value.length() - 1))
             {
-                s_log = s;
-                bd_table.read_line (i+1);
-                // calculating the value of logic-expression
-                parser_where :: init (s_log, bd_table);
-                num = parser_where :: W31 (s_log, bd_table);
-                if (num)
+                vector <bool> found = dict_where (c_num, s);
+                while (sc.next ())
                 {
-                    vect.push_back (i + 1);
+                    if (found[sc.code (c_num)])
+                    {
+                        vect.push_back (sc.line_num ());
+                    }
                 }
+                break;
             }
+            // the logic-expression is compiled once for the same clause
+            key = query_cache :: program_key ("WHERE", s, bd_table);
+            prog = query_cache :: find_program (key, bd_table);
+            if (prog == NULL)
+            {
+                where_compiler :: compile_log (s, bd_table, tree);
+                where_vm :: compile (tree, compiled);
+                prog = &(query_cache :: add_program (key, compiled));
+            }
+            check_records (*prog, sc, vect);
             break;
             
         case ALL_alt:
-            // all records
-            for (unsigned long i = 0; i < 
-                 bd_table.t_struct.num_of_records; i++)
+            // all not deleted records
+            while (sc.next ())
             {
-                vect.push_back (i + 1);
+                vect.push_back (sc.line_num ());
             }
             break;
     }
+    bd_table.use_all_fields ();
     sort(vect.begin(), vect.end());
     vect.erase(unique(vect.begin(), vect.end()), vect.end());
     return vect;
 }
 
+void Interpreter :: check_records (where_program & prog, Table :: Scanner & sc,
+                                   vector <unsigned long> & vect)
+{
+    if (where_batch :: fits (prog))
+    {
+        where_batch :: run (prog, sc, vect);
+        return;
+    }
+    while (sc.next ())
+    {
+        if (where_vm :: run (prog, sc))
+        {
+            vect.push_back (sc.line_num ());
+        }
+    }
+}
+
+// the where-clause of one field and constants:
+// "( field REL constant )", "field [NOT] IN ( ... )" and
+// "field LIKE pattern", the constant can be before the field
+bool Interpreter :: simple_condition (string s, unsigned long & f_num, 
+                                      string & op, string & value)
+{
+    vector <string> words;
+    while (!s.empty())
+    {
+        string w = read_word (s);
+        if (!w.empty())
+        {
+            words.push_back (w);
+        }
+    }
+    // brackets around the whole condition
+    while ((words.size() > 2) && (words.front() == "(") && 
+           (words.back() == ")"))
+    {
+        words.erase (words.begin());
+        words.pop_back();
+    }
+    string f_name;
+    if ((parser_where::mode == LOG_alt) && (words.size() >= 3))
+    {
+        // the constant can be before the field
+        if ((words[0][0] == '\'') || isdigit (words[0][0]))
+        {
+            f_name = words.back();
+            op = words[words.size() - 2];
+            words.resize (words.size() - 2);
+            if (op[0] == '<')
+            {
+                op[0] = '>';
+            }
+            else if (op[0] == '>')
+            {
+                op[0] = '<';
+            }
+        }
+        else
+        {
+            f_name = words[0];
+            op = words[1];
+            words.erase (words.begin(), words.begin() + 2);
+        }
+        // words of the string are joined back
+        for (unsigned long i = 0; i < words.size(); i++)
+        {
+            if (i > 0)
+            {
+                value += " ";
+            }
+            value += words[i];
+        }
+    }
+    else if ((parser_where::mode == LIKE_alt) && (words.size() == 3) &&
+             (words[1] == "LIKE"))
+    {
+        f_name = words[0];
+        op = "LIKE";
+        value = words[2];
+    }
+    else if (((parser_where::mode == IN_alt_L) || 
+              (parser_where::mode == IN_alt_T)) && (words.size() == 2) && 
+             (words[1] == "IN"))
+    {
+        f_name = words[0];
+        op = "IN";
+    }
+    else if (((parser_where::mode == IN_alt_L) || 
+              (parser_where::mode == IN_alt_T)) && (words.size() == 3) && 
+             (words[1] == "NOT") && (words[2] == "IN"))
+    {
+        f_name = words[0];
+        op = "NOT";
+    }
+    else
+    {
+        return false;
+    }
+    try
+    {
+        f_num = bd_table.get_field_num (f_name.c_str());
+    }
+    catch (TableException &)
+    {
+        return false;
+    }
+    return true;
+}
+
+// records of the simple condition found by the index of the field,
+// false if there is no index for such condition
+bool Interpreter :: index_scan (unsigned long f_num, string op, string value,
+                                vector <unsigned long> & vect)
+{
+    if (bd_table.fields[f_num].type == LONG)
+    {
+        return long_index_scan (f_num, op, value, vect);
+    }
+    return text_index_scan (f_num, op, value, vect);
+}
+
+vector <bool> Interpreter :: dict_like (unsigned long f_num, 
+                                        like_pattern & pattern)
+{
+    vector <bool> found;
+    if (bd_table.encoded (f_num))
+    {
+        const vector <string> & values = bd_table.dict_values (f_num);
+        for (unsigned long i = 0; i < values.size(); i++)
+        {
+            found.push_back (like :: match (pattern, values[i].data(), 
+                                            values[i].length()));
+        }
+    }
+    return found;
+}
+
+vector <bool> Interpreter :: dict_in (unsigned long f_num)
+{
+    vector <bool> found;
+    if (bd_table.encoded (f_num))
+    {
+        const vector <string> & values = bd_table.dict_values (f_num);
+        for (unsigned long i = 0; i < values.size(); i++)
+        {
+            found.push_back (parser_where::mst_s.count (values[i]) != 0);
+        }
+    }
+    return found;
+}
+
+// the logic expression of one field gets every value of the dictionary
+vector <bool> Interpreter :: dict_where (unsigned long f_num, string s)
+{
+    vector <bool> found;
+    const vector <string> & values = bd_table.dict_values (f_num);
+    for (unsigned long i = 0; i < values.size(); i++)
+    {
+        memset (bd_table.fields[f_num].text, 0, MAX_TEXT_LEN);
+        memcpy (bd_table.fields[f_num].text, values[i].c_str(), 
+                values[i].length());
+        string s_log = s;
+        parser_where :: init (s_log, bd_table);
+        found.push_back (parser_where :: W31 (s_log, bd_table) != 0);
+    }
+    return found;
+}
+
+// the condition becomes ranges of values in the B+tree
+bool Interpreter :: long_index_scan (unsigned long f_num, string op, 
+                                     string value, 
+                                     vector <unsigned long> & vect)
+{
+    index_struct * idx = bd_table.find_index (f_num, BTREE_INDEX);
+    vector <pair <long, long> > ranges;
+    if ((idx == NULL) || !long_ranges (op, value, ranges))
+    {
+        return false;
+    }
+    for (unsigned long i = 0; i < ranges.size(); i++)
+    {
+        bd_table.index_find (*idx, ranges[i].first, ranges[i].second, vect);
+    }
+    return true;
+}
+
+// the condition becomes ranges of values from the first to the second
+bool Interpreter :: long_ranges (string op, string value, 
+                                 vector <pair <long, long> > & ranges)
+{
+    long num = 0;
+    if ((op != "IN") && (op != "NOT"))
+    {
+        if (value.empty() || (value.length() > 18) || 
+            (value.find_first_not_of ("0123456789") != string :: npos))
+        {
+            return false;
+        }
+        num = stol (value);
+    }
+    set <long> values;
+    if (op == "IN")
+    {
+        values.insert (parser_where::mst_l.begin(), 
+                       parser_where::mst_l.end());
+        set <long> :: iterator it;
+        for (it = values.begin(); it != values.end(); it++)
+        {
+            ranges.push_back (make_pair (*it, *it));
+        }
+    }
+    else if ((op == "NOT") || (op == "!="))
+    {
+        if (op == "NOT")
+        {
+            values.insert (parser_where::mst_l.begin(), 
+                           parser_where::mst_l.end());
+        }
+        else
+        {
+            values.insert (num);
+        }
+        // the ranges between the values
+        long from = LONG_MIN;
+        set <long> :: iterator it;
+        for (it = values.begin(); it != values.end(); it++)
+        {
+            if (*it > from)
+            {
+                ranges.push_back (make_pair (from, *it - 1));
+            }
+            from = *it + 1;
+        }
+        if ((values.empty()) || (*(values.rbegin()) < LONG_MAX))
+        {
+            ranges.push_back (make_pair (from, LONG_MAX));
+        }
+    }
+    else if (op == "=")
+    {
+        ranges.push_back (make_pair (num, num));
+    }
+    else if (op == "<")
+    {
+        ranges.push_back (make_pair (LONG_MIN, num - 1));
+    }
+    else if (op == "<=")
+    {
+        ranges.push_back (make_pair (LONG_MIN, num));
+    }
+    else if (op == ">")
+    {
+        ranges.push_back (make_pair (num + 1, LONG_MAX));
+    }
+    else if (op == ">=")
+    {
+        ranges.push_back (make_pair (num, LONG_MAX));
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// the zone is skipped if its values are out of all ranges of the condition
+vector <bool> Interpreter :: zone_filter (unsigned long f_num, string op, 
+                                          string value)
+{
+    vector <bool> skipped;
+    if (bd_table.fields[f_num].type == TEXT)
+    {
+        // Bloom filters of zones know which texts the zones can't have
+        index_struct * idx = bd_table.find_index (f_num, BLOOM_INDEX);
+        set <string> values;
+        if ((idx != NULL) && text_values (op, value, values))
+        {
+            bd_table.index_zones (*idx, vector <string> (values.begin(), 
+                                                         values.end()), 
+                                  skipped);
+        }
+        return skipped;
+    }
+    vector <pair <long, long> > ranges;
+    if (!long_ranges (op, value, ranges))
+    {
+        return skipped;
+    }
+    vector <zone_range> zones;
+    bd_table.zone_ranges (f_num, zones);
+    for (unsigned long z = 0; z < zones.size(); z++)
+    {
+        bool skip = true;
+        for (unsigned long i = 0; skip && (i < ranges.size()); i++)
+        {
+            skip = (zones[z].max < ranges[i].first) || 
+                   (zones[z].min > ranges[i].second);
+        }
+        skipped.push_back (skip);
+    }
+    return skipped;
+}
+
+// every text of the condition is found in the hash index
+bool Interpreter :: text_index_scan (unsigned long f_num, string op, 
+                                     string value, 
+                                     vector <unsigned long> & vect)
+{
+    if (op == "LIKE")
+    {
+        return like_index_scan (f_num, value, vect);
+    }
+    index_struct * idx = bd_table.find_index (f_num, HASH_INDEX);
+    set <string> values;
+    if ((idx == NULL) || !text_values (op, value, values))
+    {
+        return false;
+    }
+    set <string> :: iterator it;
+    for (it = values.begin(); it != values.end(); it++)
+    {
+        bd_table.index_find (*idx, *it, vect);
+    }
+    return true;
+}
+
+// "= 'text'" gives one text, IN gives the texts of the list
+bool Interpreter :: text_values (string op, string value, 
+                                 set <string> & values)
+{
+    if (op == "IN")
+    {
+        values.insert (parser_where::mst_s.begin(), 
+                       parser_where::mst_s.end());
+    }
+    else if (op == "=")
+    {
+        // the string without apostrophes
+        if ((value.length() < 2) || (value[0] != '\'') || 
+            (value.find ('\'', 1) != value.length() - 1))
+        {
+            return false;
+        }
+        values.insert (value.substr (1, value.length() - 2));
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// the trigram index gives records with all fragments the pattern
+// requires, the pattern is checked only for them
+bool Interpreter :: like_index_scan (unsigned long f_num, string value, 
+                                     vector <unsigned long> & vect)
+{
+    index_struct * idx = bd_table.find_index (f_num, TRIGRAM_INDEX);
+    if ((idx == NULL) || (value.length() < 2))
+    {
+        return false;
+    }
+    // the pattern without apostrophes
+    string pattern = value.substr (1, value.length() - 2);
+    vector <string> parts = like :: fragments (pattern);
+    // without trigrams the index can't narrow the search
+    bool useful = false;
+    for (unsigned long i = 0; i < parts.size(); i++)
+    {
+        useful = useful || (parts[i].length() >= 3);
+    }
+    if (!useful)
+    {
+        return false;
+    }
+    like_pattern & matcher = query_cache :: pattern (pattern);
+    vector <unsigned long> found;
+    bd_table.index_find (*idx, parts, found);
+    for (unsigned long i = 0; i < found.size(); i++)
+    {
+        string text = bd_table.get_text (found[i], f_num);
+        if (like :: match (matcher, text.data(), text.length()))
+        {
+            vect.push_back (found[i]);
+        }
+    }
+    return true;
+}
+
 #endif